@@ -246,33 +246,34 @@ NTSTATUS BOOTTRACKPAD(
 	uint8_t hw_res_x = val2[0];
 	uint8_t hw_res_y = val2[1];
 
-	hw_res_x = (hw_res_x * 10 + 790) * 10 / 254;
-	hw_res_y = (hw_res_y * 10 + 790) * 10 / 254;
-
+	pDevice->max_x = max_x;
 	pDevice->max_y = max_y;
 
 	csgesture_softc *sc = &pDevice->sc;
 	sprintf(sc->product_id, "%d.0", prodid);
 	sprintf(sc->firmware_version, "%d.0", version);
 
-	pDevice->hw_res_x = hw_res_x;
-	pDevice->hw_res_y = hw_res_y;
-
-	/*sc->resx = max_x;
-	sc->resy = max_y;
-
-	sc->resx *= 2;
-	sc->resx /= 7;
-
-	sc->resy *= 2;
-	sc->resy /= 7;*/
+	//
+	// Keep the resolution in fixed point; the engine works in sensor units
+	// and only converts to physical units at HID output.
+	//
+	sc->unitspermmx = ((hw_res_x * 10 + 790) * 10 * CSGESTURE_FP_ONE) / 254;
+	sc->unitspermmy = ((hw_res_y * 10 + 790) * 10 * CSGESTURE_FP_ONE) / 254;
 
-	sc->resx = max_x * 10 / hw_res_x;
-	sc->resy = max_y * 10 / hw_res_y;
+	sc->resx = max_x << CSGESTURE_FP_SHIFT;
+	sc->resy = max_y << CSGESTURE_FP_SHIFT;
 
 	sc->phyx = max_x;
 	sc->phyy = max_y;
 
+	if (x_traces)
+		sc->tracewidthx = sc->resx / x_traces;
+	if (y_traces)
+		sc->tracewidthy = sc->resy / y_traces;
+
+	SetGestureProfile(sc, prodid, version);
+	SetGestureThresholds(sc);
+
 	DbgPrint( "[etp] ProdID: %d Vers: %d Csum: %d SmVers: %d IAPVers: %d Max X: %d Max Y: %d X Traces: %d Y Traces: %d\n", prodid, version, csum, smvers, iapversion, max_x, max_y, x_traces, y_traces);
 
 	elan_i2c_write_cmd(pDevice, ETP_I2C_SET_CMD, ETP_ENABLE_CALIBRATE | ETP_ENABLE_ABS);
@@ -555,6 +556,14 @@ VOID
 		//
 		status = ElanGetFeature(pDevice, FxRequest, &fSync);
 		break;
+
+	case IOCTL_HID_SET_FEATURE:
+		//
+		// sends a feature report to a top-level collection
+		//
+		status = ElanSetFeature(pDevice, FxRequest);
+		fSync = TRUE;
+		break;
 	case IOCTL_HID_ACTIVATE_DEVICE:
 		//
 		// Makes the device ready for I/O operations.
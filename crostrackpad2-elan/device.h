@@ -20,6 +20,8 @@ EVT_WDF_IO_QUEUE_IO_DEVICE_CONTROL   OnIoDeviceControl;
 EVT_WDF_INTERRUPT_ISR                OnInterruptIsr;
 EVT_WDF_TIMER OnPollTimerFunc;
 
+void SetGestureProfile(struct csgesture_softc *sc, int prodid, int fwversion);
+void SetGestureThresholds(struct csgesture_softc *sc);
 void ProcessSetting(PDEVICE_CONTEXT pDevice, struct csgesture_softc *sc, int settingRegister, int settingValue);
 
 #endif
\ No newline at end of file
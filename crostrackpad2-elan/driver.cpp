@@ -15,8 +15,6 @@ void ElanTimerFunc(_In_ WDFTIMER hTimer);
 #define NT_DEVICE_NAME      L"\\Device\\ELANTP"
 #define DOS_DEVICE_NAME     L"\\DosDevices\\ELANTP"
 
-#define MAX_FINGERS 5
-
 //#include "driver.tmh"
 
 NTSTATUS
@@ -339,6 +337,69 @@ exit:
 }
 
 
+typedef bool(*ElanReportHandler)(PDEVICE_CONTEXT pDevice, uint8_t report[ETP_MAX_REPORT_LEN]);
+
+static bool ElanTouchReport(PDEVICE_CONTEXT pDevice, uint8_t report[ETP_MAX_REPORT_LEN]) {
+	//
+	// Every contact bit must be backed by finger data inside the axis range
+	// reported at bring-up, otherwise the frame is garbage.
+	//
+	uint8_t *finger_data = &report[ETP_FINGER_DATA_OFFSET];
+	uint8_t tp_info = report[ETP_TOUCH_INFO_OFFSET];
+
+	for (int i = 0; i < ETP_MAX_FINGERS; i++) {
+		if (!(tp_info & (1U << (3 + i))))
+			continue;
+
+		unsigned int pos_x = ((finger_data[0] & 0xf0) << 4) | finger_data[1];
+		unsigned int pos_y = ((finger_data[0] & 0x0f) << 8) | finger_data[2];
+		if (pos_x > pDevice->max_x || pos_y > pDevice->max_y) {
+			pDevice->FramesDropped[ETP_DROP_CONTACT]++;
+			return false;
+		}
+		finger_data += ETP_FINGER_DATA_LEN;
+	}
+
+	for (int i = 0; i < ETP_MAX_REPORT_LEN; i++)
+		pDevice->lastreport[i] = report[i];
+	pDevice->LastInterruptTime = KeQueryInterruptTime();
+	return true;
+}
+
+//
+// Indexed by report[ETP_REPORT_ID_OFFSET] - ETP_REPORT_ID_BASE. Additional
+// Elan report types get a slot here instead of a branch in the ISR.
+//
+static const ElanReportHandler ElanReportHandlers[ETP_REPORT_ID_COUNT] = {
+	ElanTouchReport,	// 0x5D touch
+	NULL,				// 0x5E trackpoint
+	NULL,				// 0x5F
+	NULL				// 0x60 high precision touch
+};
+
+static void ElanDispatchReport(PDEVICE_CONTEXT pDevice, uint8_t report[ETP_MAX_REPORT_LEN]) {
+	if (report[0] == 0xff) {
+		pDevice->FramesDropped[ETP_DROP_EMPTY]++;
+		return;
+	}
+
+	uint16_t len = report[0] | (report[1] << 8);
+	if (len != ETP_I2C_REPORT_LEN) {
+		pDevice->FramesDropped[ETP_DROP_LENGTH]++;
+		return;
+	}
+
+	unsigned int slot = (unsigned int)report[ETP_REPORT_ID_OFFSET] - ETP_REPORT_ID_BASE;
+	ElanReportHandler handler = slot < ETP_REPORT_ID_COUNT ? ElanReportHandlers[slot] : NULL;
+	if (handler == NULL) {
+		pDevice->FramesDropped[ETP_DROP_REPORT_ID]++;
+		return;
+	}
+
+	if (handler(pDevice, report))
+		pDevice->FramesAccepted++;
+}
+
 BOOLEAN OnInterruptIsr(
 	WDFINTERRUPT Interrupt,
 	ULONG MessageID){
@@ -352,13 +413,14 @@ BOOLEAN OnInterruptIsr(
 	}
 
 	uint8_t report[ETP_MAX_REPORT_LEN];
-	SpbReadDataSynchronously(&pDevice->I2CContext, 0, &report, sizeof(report));
-
-	if (report[0] != 0xff) {
-		for (int i = 0; i < ETP_MAX_REPORT_LEN; i++)
-			pDevice->lastreport[i] = report[i];
+	NTSTATUS status = SpbReadDataSynchronously(&pDevice->I2CContext, 0, &report, sizeof(report));
+	if (!NT_SUCCESS(status)) {
+		pDevice->FramesDropped[ETP_DROP_IO]++;
+		return true;
 	}
 
+	ElanDispatchReport(pDevice, report);
+
 	return true;
 }
 
@@ -371,23 +433,90 @@ void ElanTimerFunc(_In_ WDFTIMER hTimer){
 
 	uint8_t *report = pDevice->lastreport;
 
-	if (report[0] != 0xff) {
-		csgesture_softc sc = pDevice->sc;
-		TrackpadRawInput(pDevice, &sc, report, 1);
-		pDevice->sc = sc;
-	}
+	if (report[0] != 0xff)
+		TrackpadRawInput(pDevice, &pDevice->sc, report, 1);
 
 	return;
 }
 
-static int distancesq(int delta_x, int delta_y) {
-	return (delta_x * delta_x) + (delta_y*delta_y);
+//the timer drives the engine at one frame per tick
+#define GESTURE_TICK_MS 10
+
+static void window_reset(csgesture_window *w) {
+	w->head = 0;
+	w->count = 0;
+	w->sum = 0;
+}
+
+static void window_push(csgesture_window *w, int len, int sample) {
+	//the length can change under a running frame; never index past it
+	if (w->count > len || w->head >= len)
+		window_reset(w);
+
+	//once full, head points at the oldest sample
+	if (w->count == len)
+		w->sum -= w->samples[w->head];
+	else
+		w->count++;
+	w->samples[w->head] = sample;
+	w->sum += sample;
+	if (++w->head >= len)
+		w->head = 0;
+}
+
+static int window_average(csgesture_window *w) {
+	if (w->count == 0)
+		return 0;
+	return w->sum / w->count;
 }
 
-_ELAN_RELATIVE_MOUSE_REPORT lastreport;
+static int64_t distancesq(int delta_x, int delta_y) {
+	return ((int64_t)delta_x * delta_x) + ((int64_t)delta_y * delta_y);
+}
 
-static void update_relative_mouse(PDEVICE_CONTEXT pDevice, BYTE button,
-	BYTE x, BYTE y, BYTE wheelPosition, BYTE wheelHPosition) {
+static uint32_t contactbit(int i) {
+	if (i < 0)
+		return 0;
+	return 1U << i;
+}
+
+static int contactcount(uint32_t mask) {
+	mask = mask - ((mask >> 1) & 0x55555555);
+	mask = (mask & 0x33333333) + ((mask >> 2) & 0x33333333);
+	return (((mask + (mask >> 4)) & 0x0F0F0F0F) * 0x01010101) >> 24;
+}
+
+//index of the lowest set bit; mask must be non-zero
+static int firstcontact(uint32_t mask) {
+	ULONG index;
+	BitScanForward(&index, mask);
+	return (int)index;
+}
+
+//
+// Output is edge triggered: a report identical to the last one delivered on its
+// stream is dropped instead of consuming a pended read. The last report is only
+// recorded once it is delivered, so a report that found no pended read is
+// retried by the next frame that produces it. Returns false when the report
+// was not delivered.
+//
+static bool send_report(PDEVICE_CONTEXT pDevice, elan_output output, PVOID report, ULONG length, PVOID last, bool force) {
+	if (!force && RtlEqualMemory(report, last, length)) {
+		pDevice->ReportsSuppressed[output]++;
+		return true;
+	}
+
+	size_t bytesWritten;
+	if (NT_SUCCESS(ElanProcessVendorReport(pDevice, report, length, &bytesWritten))) {
+		RtlCopyMemory(last, report, length);
+		pDevice->ReportsSent[output]++;
+		return true;
+	}
+	return false;
+}
+
+static bool update_relative_mouse(PDEVICE_CONTEXT pDevice, BYTE button,
+	SHORT x, SHORT y, BYTE wheelPosition, BYTE wheelHPosition) {
 	_ELAN_RELATIVE_MOUSE_REPORT report;
 	report.ReportID = REPORTID_RELATIVE_MOUSE;
 	report.Button = button;
@@ -395,19 +524,13 @@ static void update_relative_mouse(PDEVICE_CONTEXT pDevice, BYTE button,
 	report.YValue = y;
 	report.WheelPosition = wheelPosition;
 	report.HWheelPosition = wheelHPosition;
-	if (report.Button == lastreport.Button &&
-		report.XValue == lastreport.XValue &&
-		report.YValue == lastreport.YValue &&
-		report.WheelPosition == lastreport.WheelPosition &&
-		report.HWheelPosition == lastreport.HWheelPosition)
-		return;
-	lastreport = report;
 
-	size_t bytesWritten;
-	ElanProcessVendorReport(pDevice, &report, sizeof(report), &bytesWritten);
+	//relative motion is never a repeat of the last report
+	bool motion = x || y || wheelPosition || wheelHPosition;
+	return send_report(pDevice, ELAN_OUTPUT_MOUSE, &report, sizeof(report), &pDevice->LastMouseReport, motion);
 }
 
-static void update_keyboard(PDEVICE_CONTEXT pDevice, BYTE shiftKeys, BYTE keyCodes[KBD_KEY_CODES]) {
+static bool update_keyboard(PDEVICE_CONTEXT pDevice, BYTE shiftKeys, BYTE keyCodes[KBD_KEY_CODES]) {
 	_ELAN_KEYBOARD_REPORT report;
 	report.ReportID = REPORTID_KEYBOARD;
 	report.ShiftKeyFlags = shiftKeys;
@@ -415,69 +538,76 @@ static void update_keyboard(PDEVICE_CONTEXT pDevice, BYTE shiftKeys, BYTE keyCod
 		report.KeyCodes[i] = keyCodes[i];
 	}
 
-	size_t bytesWritten;
-	ElanProcessVendorReport(pDevice, &report, sizeof(report), &bytesWritten);
+	return send_report(pDevice, ELAN_OUTPUT_KEYBOARD, &report, sizeof(report), &pDevice->LastKeyboardReport, false);
 }
 
-static void stop_scroll(PDEVICE_CONTEXT pDevice) {
-	_ELAN_SCROLL_REPORT report;
-	report.ReportID = REPORTID_SCROLL;
-	report.Flag = 1;
-	report.Touch1XValue = 65535;
-	report.Touch1YValue = 65535;
-	report.Touch2XValue = 65535;
-	report.Touch2YValue = 65535;
+//
+// Extrapolates one axis of the panning contact by horizon (Q8 ticks) from its
+// velocity and acceleration. While slowing down only half the velocity lead is
+// used so the cursor does not overshoot where the finger stops, and the lead
+// is capped at twice the velocity lead.
+//
+static int predict_lead(int velocity, int lastvelocity, int horizon) {
+	if (velocity == 0)
+		return 0;
+	int64_t vlead = (int64_t)velocity * horizon;
+	int accel = velocity - lastvelocity;
+	int64_t lead;
+	if ((velocity < 0) != (accel < 0) && accel != 0)
+		lead = vlead / 2;
+	else {
+		lead = vlead + (int64_t)accel * horizon * horizon / (2 << 8);
+		int64_t bound = 2 * (vlead < 0 ? -vlead : vlead);
+		if (lead > bound || lead < -bound)
+			lead = 2 * vlead;
+	}
+	return (int)(lead >> 8);
+}
 
-	size_t bytesWritten;
-	ElanProcessVendorReport(pDevice, &report, sizeof(report), &bytesWritten);
+static void ResetPrediction(csgesture_softc *sc, int i) {
+	sc->predictid = i;
+	sc->predictvx = 0;
+	sc->predictvy = 0;
+	sc->predictleadx = 0;
+	sc->predictleady = 0;
 }
 
-USHORT filterNegative(int val) {
-	if (val > 0)
-		return val;
-	return 65535;
+static void PredictMove(csgesture_softc *sc, int i, int *delta_x, int *delta_y) {
+	if (sc->predictid != i)
+		ResetPrediction(sc, i);
+
+	int horizon = sc->settings.predictHorizon * 256 / GESTURE_TICK_MS;
+	int leadx = predict_lead(*delta_x, sc->predictvx, horizon);
+	int leady = predict_lead(*delta_y, sc->predictvy, horizon);
+	sc->predictvx = *delta_x;
+	sc->predictvy = *delta_y;
+
+	*delta_x += leadx - sc->predictleadx;
+	*delta_y += leady - sc->predictleady;
+	sc->predictleadx = leadx;
+	sc->predictleady = leady;
 }
 
-bool ProcessMove(PDEVICE_CONTEXT pDevice, csgesture_softc *sc, int abovethreshold, int iToUse[3]) {
+bool ProcessMove(PDEVICE_CONTEXT pDevice, csgesture_softc *sc, uint32_t active, int abovethreshold, int iToUse[3]) {
 	if (abovethreshold == 1 || sc->panningActive) {
 		int i = iToUse[0];
 		if (!sc->panningActive && sc->tick[i] < 5)
 			return false;
 
-		stop_scroll(pDevice);
-
 		if (sc->panningActive && i == -1)
 			i = sc->idForPanning;
+		if (!(active & contactbit(i)))
+			return false;
 
 		int delta_x = sc->x[i] - sc->lastx[i];
 		int delta_y = sc->y[i] - sc->lasty[i];
 
-		if (abs(delta_x) > 75 || abs(delta_y) > 75) {
-			delta_x = 0;
-			delta_y = 0;
-		}
-
-		for (int j = 0;j < MAX_FINGERS;j++) {
-			if (j != i) {
-				if (sc->blacklistedids[j] != 1) {
-					if (sc->y[j] > sc->y[i]) {
-						if (sc->truetick[j] > sc->truetick[i] + 15) {
-							sc->blacklistedids[j] = 1;
-						}
-					}
-				}
-			}
-		}
+		if (sc->settings.predictHorizon > 0)
+			PredictMove(sc, i, &delta_x, &delta_y);
 
 		sc->dx = delta_x;
 		sc->dy = delta_y;
 
-		sc->dx *= sc->settings.pointerMultiplier;
-		sc->dx /= 10;
-
-		sc->dy *= sc->settings.pointerMultiplier;
-		sc->dy /= 10;
-
 		sc->panningActive = true;
 		sc->idForPanning = i;
 		return true;
@@ -485,17 +615,179 @@ bool ProcessMove(PDEVICE_CONTEXT pDevice, csgesture_softc *sc, int abovethreshol
 	return false;
 }
 
-bool ProcessScroll(PDEVICE_CONTEXT pDevice, csgesture_softc *sc, int abovethreshold, int iToUse[3]) {
-	if (!sc->settings.scrollEnabled)
-		return false;
+//
+// Momentum scrolling: when the scrolling fingers lift, their release velocity
+// keeps scrolling as wheel output, keeping scrollFriction per mille of its
+// speed each tick until it falls below one detent per second. Any touch stops
+// it, and the stopping touch is not a tap.
+//
+static void StartMomentum(csgesture_softc *sc) {
+	if (sc->settings.scrollFriction <= 0)
+		return;
+	if (abs(sc->scrollvx) < sc->thresholds.scrollstartx && abs(sc->scrollvy) < sc->thresholds.scrollstarty)
+		return;
 
-	sc->scrollx = 0;
-	sc->scrolly = 0;
+	sc->momentumActive = true;
+	sc->momentumvx = sc->scrollvx;
+	sc->momentumvy = sc->scrollvy;
+}
+
+static void StopMomentum(csgesture_softc *sc) {
+	sc->momentumActive = false;
+	sc->momentumvx = 0;
+	sc->momentumvy = 0;
+}
+
+//
+// Scroll distance becomes wheel counts at resolution counts per detent; the
+// part of a count not yet sent is carried, in sensor units times resolution.
+//
+static int wheel_counts(int *remainder, int distance, int detent, int resolution) {
+	int64_t scaled = (int64_t)distance * resolution + *remainder;
+	int64_t counts = scaled / detent;
+	if (counts > MAX_WHEEL_POS)
+		counts = MAX_WHEEL_POS;
+	else if (counts < MIN_WHEEL_POS)
+		counts = MIN_WHEEL_POS;
+
+	//counts beyond one report's range go out with the next frames, at most a report's worth behind
+	int64_t unsent = scaled - counts * detent;
+	int64_t backlog = (int64_t)MAX_WHEEL_POS * detent;
+	if (unsent > backlog)
+		unsent = backlog;
+	else if (unsent < -backlog)
+		unsent = -backlog;
+	*remainder = (int)unsent;
+	return (int)counts;
+}
+
+//fingers moving down scroll the content down; moving right reveals the left
+static void ScrollWheel(csgesture_softc *sc, int distancex, int distancey) {
+	sc->scrolly = wheel_counts(&sc->wheelremy, distancey, sc->thresholds.wheeldetenty, sc->wheelresy);
+	sc->scrollx = -wheel_counts(&sc->wheelremx, distancex, sc->thresholds.wheeldetentx, sc->wheelresx);
+}
+
+void ProcessMomentum(csgesture_softc *sc) {
+	if (!sc->momentumActive)
+		return;
+	if (sc->newmask) {
+		sc->momentumstopmask |= sc->newmask;
+		StopMomentum(sc);
+		return;
+	}
+
+	ScrollWheel(sc, sc->momentumvx, sc->momentumvy);
+
+	sc->momentumvx = (int)((int64_t)sc->momentumvx * sc->settings.scrollFriction / 1000);
+	sc->momentumvy = (int)((int64_t)sc->momentumvy * sc->settings.scrollFriction / 1000);
+	if (abs(sc->momentumvx) < sc->thresholds.momentumstopx && abs(sc->momentumvy) < sc->thresholds.momentumstopy)
+		StopMomentum(sc);
+}
+
+//
+// Pinch to zoom: two fingers whose spread changes by more than pinchstart, and
+// by more than they have moved together, hold ctrl and send the spread as
+// wheel output until either lifts. Spreading zooms in. A scroll that commits
+// first keeps the gesture, and an active pinch keeps it from scrolling.
+//
+static int contact_spread(csgesture_softc *sc, int i1, int i2, bool last) {
+	int ax = last ? abs(sc->lastx[i1] - sc->lastx[i2]) : abs(sc->x[i1] - sc->x[i2]);
+	int ay = last ? abs(sc->lasty[i1] - sc->lasty[i2]) : abs(sc->y[i1] - sc->y[i2]);
+	return max(ax, ay) + min(ax, ay) / 2;
+}
+
+static void ResetPinch(csgesture_softc *sc) {
+	sc->pinchspread = 0;
+	sc->pinchtravel = 0;
+}
+
+//
+// Keyboard output is only recorded once delivered, so ctrl is sent again every
+// frame of the pinch and the edge-triggered layer drops the repeats. Until the
+// press is delivered the spread is held back, or the host would scroll. The
+// release is likewise sent every frame until delivered.
+//
+void ReleasePinchKeys(PDEVICE_CONTEXT pDevice, csgesture_softc *sc) {
+	if (!sc->pinchrelease || sc->pinchActive)
+		return;
+	//a swipe that has taken the keyboard since sends its own keys
+	if (sc->swipestate != SwipeStateIdle) {
+		sc->pinchrelease = false;
+		return;
+	}
+
+	BYTE keyCodes[KBD_KEY_CODES] = { 0, 0, 0, 0, 0, 0 };
+	if (update_keyboard(pDevice, 0, keyCodes))
+		sc->pinchrelease = false;
+}
+
+static void EndPinch(PDEVICE_CONTEXT pDevice, csgesture_softc *sc) {
+	sc->pinchActive = false;
+	sc->idsForPinch[0] = -1;
+	sc->idsForPinch[1] = -1;
+	ResetPinch(sc);
+
+	sc->pinchrelease = true;
+	ReleasePinchKeys(pDevice, sc);
+}
+
+bool ProcessPinch(PDEVICE_CONTEXT pDevice, csgesture_softc *sc, uint32_t active, int abovethreshold, int iToUse[3]) {
+	if (sc->pinchActive) {
+		int i1 = sc->idsForPinch[0];
+		int i2 = sc->idsForPinch[1];
+		if (contactcount(active & (contactbit(i1) | contactbit(i2))) < 2) {
+			EndPinch(pDevice, sc);
+			return true;
+		}
+
+		sc->pinchspread += contact_spread(sc, i1, i2, false) - contact_spread(sc, i1, i2, true);
+	}
+	else {
+		if (abovethreshold != 2 || sc->scrollingActive || sc->swipestate != SwipeStateIdle) {
+			ResetPinch(sc);
+			return false;
+		}
+
+		int i1 = iToUse[0];
+		int i2 = iToUse[1];
+		if (sc->truetick[i1] < 4 && sc->truetick[i2] < 4)
+			return false;
+		if (sc->lastx[i1] == -1 || sc->lastx[i2] == -1)
+			return false;
+
+		int spread = contact_spread(sc, i1, i2, false) - contact_spread(sc, i1, i2, true);
+
+		int tx = abs((sc->x[i1] - sc->lastx[i1]) + (sc->x[i2] - sc->lastx[i2])) / 2;
+		int ty = abs((sc->y[i1] - sc->lasty[i1]) + (sc->y[i2] - sc->lasty[i2])) / 2;
+
+		sc->pinchspread += spread;
+		sc->pinchtravel += max(tx, ty) + min(tx, ty) / 2;
+
+		if (abs(sc->pinchspread) < sc->thresholds.pinchstart || abs(sc->pinchspread) < sc->pinchtravel)
+			return false;
+
+		sc->pinchActive = true;
+		sc->pinchrelease = false;
+		sc->idsForPinch[0] = i1;
+		sc->idsForPinch[1] = i2;
+		sc->pinchrem = 0;
+		StopMomentum(sc);
+	}
+
+	BYTE keyCodes[KBD_KEY_CODES] = { 0, 0, 0, 0, 0, 0 };
+	if (update_keyboard(pDevice, KBD_LCONTROL_BIT, keyCodes)) {
+		sc->scrolly = wheel_counts(&sc->pinchrem, sc->pinchspread, sc->thresholds.pinchdetent, sc->wheelresy);
+		sc->pinchspread = 0;
+	}
+	return true;
+}
+
+bool ProcessScroll(PDEVICE_CONTEXT pDevice, csgesture_softc *sc, uint32_t active, int abovethreshold, int iToUse[3]) {
 	if (abovethreshold == 2 || sc->scrollingActive) {
 		int i1 = iToUse[0];
 		int i2 = iToUse[1];
 
-		if (!sc->scrollingActive && !sc->scrollInertiaActive) {
+		if (!sc->scrollingActive) {
 			if (sc->truetick[i1] < 4 && sc->truetick[i2] < 4)
 				return false; 
 		}
@@ -572,28 +864,26 @@ bool ProcessScroll(PDEVICE_CONTEXT pDevice, csgesture_softc *sc, int abovethresh
 			scrollx = avgx;
 		}
 
-		if (abs(scrollx) < 5 && abs(scrolly) < 5 && !sc->scrollingActive)
+		if (abs(scrollx) < sc->thresholds.scrollstartx && abs(scrolly) < sc->thresholds.scrollstarty && !sc->scrollingActive)
 			return false;
 
-		_ELAN_SCROLL_REPORT report;
-		report.ReportID = REPORTID_SCROLL;
-		report.Flag = 0;
-		report.Touch1XValue = filterNegative(sc->x[i1]);
-		report.Touch1YValue = filterNegative(sc->y[i1]);
-		report.Touch2XValue = filterNegative(sc->x[i2]);
-		report.Touch2YValue = filterNegative(sc->y[i2]);
+		if (!sc->scrollingActive) {
+			sc->wheelremx = 0;
+			sc->wheelremy = 0;
+		}
 
-		size_t bytesWritten;
-		ElanProcessVendorReport(pDevice, &report, sizeof(report), &bytesWritten);
+		int fngrcount = contactcount(active & (contactbit(i1) | contactbit(i2)));
 
-		int fngrcount = 0;
-		int totfingers = 0;
-		for (int i = 0; i < MAX_FINGERS; i++) {
-			if (sc->x[i] != -1) {
-				totfingers++;
-				if (i == i1 || i == i2)
-					fngrcount++;
-			}
+		//a lifted finger's position is gone, so only two fingers scroll
+		if (fngrcount == 2) {
+			ScrollWheel(sc, scrollx, scrolly);
+			sc->scrollvx += (scrollx - sc->scrollvx) / 2;
+			sc->scrollvy += (scrolly - sc->scrollvy) / 2;
+		}
+		else if (fngrcount == 0 && (sc->scrollvx || sc->scrollvy)) {
+			StartMomentum(sc);
+			sc->scrollvx = 0;
+			sc->scrollvy = 0;
 		}
 
 		if (fngrcount == 2)
@@ -617,15 +907,128 @@ bool ProcessScroll(PDEVICE_CONTEXT pDevice, csgesture_softc *sc, int abovethresh
 	return false;
 }
 
-bool ProcessThreeFingerSwipe(PDEVICE_CONTEXT pDevice, csgesture_softc *sc, int abovethreshold, int iToUse[3]) {
-	if (sc->alttabswitchershowing) {
+//
+// Swipe bindings: for each switcher state and direction, the first row whose
+// gesture setting matches (or is SWIPE_ANY) is resolved into sc->swipeactions
+// whenever settings change. New bindings are new rows.
+//
+#define SWIPE_ANY -1
+
+struct csgesture_swipe_binding {
+	SwipeState state;
+	SwipeEvent event;
+	int gesture;
+	struct csgesture_swipe_action action;
+};
+
+static const csgesture_swipe_binding SwipeBindings[] = {
+	{ SwipeStateIdle, SwipeEventUp, SwipeUpGestureTaskView,
+		{ KBD_LGUI_BIT, 0x2B, 0, true, SwipeStateIdle } }, //Windows Key + Tab
+	{ SwipeStateIdle, SwipeEventDown, SwipeDownGestureShowDesktop,
+		{ KBD_LGUI_BIT, 0x07, 0, true, SwipeStateIdle } }, //Windows Key + D
+	{ SwipeStateIdle, SwipeEventRight, SwipeGestureSwitchWorkspace,
+		{ KBD_LGUI_BIT | KBD_LCONTROL_BIT, 0x50, 0, true, SwipeStateIdle } }, //Ctrl + Windows Key + Left
+	{ SwipeStateIdle, SwipeEventLeft, SwipeGestureSwitchWorkspace,
+		{ KBD_LGUI_BIT | KBD_LCONTROL_BIT, 0x4F, 0, true, SwipeStateIdle } }, //Ctrl + Windows Key + Right
+	{ SwipeStateIdle, SwipeEventRight, SwipeGestureAltTabSwitcher,
+		{ KBD_LALT_BIT, 0x2B, KBD_LALT_BIT, false, SwipeStateSwitcher } }, //Alt + Tab
+	{ SwipeStateIdle, SwipeEventLeft, SwipeGestureAltTabSwitcher,
+		{ KBD_LALT_BIT | KBD_LSHIFT_BIT, 0x2B, KBD_LALT_BIT, false, SwipeStateSwitcher } }, //Alt + Shift + Tab
+	{ SwipeStateSwitcher, SwipeEventUp, SWIPE_ANY,
+		{ KBD_LALT_BIT, 0x52, KBD_LALT_BIT, false, SwipeStateSwitcher } }, //Alt + Up
+	{ SwipeStateSwitcher, SwipeEventDown, SWIPE_ANY,
+		{ KBD_LALT_BIT, 0x51, KBD_LALT_BIT, false, SwipeStateSwitcher } }, //Alt + Down
+	{ SwipeStateSwitcher, SwipeEventRight, SWIPE_ANY,
+		{ KBD_LALT_BIT, 0x4F, KBD_LALT_BIT, false, SwipeStateSwitcher } }, //Alt + Right
+	{ SwipeStateSwitcher, SwipeEventLeft, SWIPE_ANY,
+		{ KBD_LALT_BIT, 0x50, KBD_LALT_BIT, false, SwipeStateSwitcher } }, //Alt + Left
+};
+
+static int SwipeGestureSetting(csgesture_settings *settings, int fingers, SwipeEvent event) {
+	switch (event) {
+	case SwipeEventUp:
+		return fingers == 3 ? settings->threeFingerSwipeUpGesture : settings->fourFingerSwipeUpGesture;
+	case SwipeEventDown:
+		return fingers == 3 ? settings->threeFingerSwipeDownGesture : settings->fourFingerSwipeDownGesture;
+	default:
+		return fingers == 3 ? settings->threeFingerSwipeLeftRightGesture : settings->fourFingerSwipeLeftRightGesture;
+	}
+}
+
+void SetSwipeActions(csgesture_softc *sc) {
+	for (int state = 0; state < SwipeStateCount; state++) {
+		for (int fingers = 3; fingers <= 4; fingers++) {
+			for (int event = 0; event < SwipeEventCount; event++) {
+				csgesture_swipe_action *action = &sc->swipeactions[state][fingers - 3][event];
+				RtlZeroMemory(action, sizeof(*action));
+
+				int gesture = SwipeGestureSetting(&sc->settings, fingers, (SwipeEvent)event);
+				for (int b = 0; b < ARRAYSIZE(SwipeBindings); b++) {
+					const csgesture_swipe_binding *binding = &SwipeBindings[b];
+					if (binding->state != state || binding->event != event)
+						continue;
+					if (binding->gesture != SWIPE_ANY && binding->gesture != gesture)
+						continue;
+					*action = binding->action;
+					break;
+				}
+			}
+		}
+	}
+}
+
+#define SWIPE_COHERENT_TICKS 2
+
+//
+// A swipe is unambiguous once every swiping contact moves fast along the same
+// axis in the same direction. Returns false while the contacts disagree.
+//
+static bool SwipeCoherent(csgesture_softc *sc, int iToUse[3], SwipeEvent *event) {
+	bool vertical = false;
+	int sign = 0;
+	for (int n = 0; n < 3; n++) {
+		int i = iToUse[n];
+		if (i == -1)
+			return false;
+		int delta_x = sc->x[i] - sc->lastx[i];
+		int delta_y = sc->y[i] - sc->lasty[i];
+
+		bool contactvertical;
+		int along;
+		if (abs(delta_y) > 2 * abs(delta_x) && abs(delta_y) >= sc->thresholds.swipevelocityy) {
+			contactvertical = true;
+			along = delta_y;
+		}
+		else if (abs(delta_x) > 2 * abs(delta_y) && abs(delta_x) >= sc->thresholds.swipevelocityx) {
+			contactvertical = false;
+			along = delta_x;
+		}
+		else
+			return false;
+
+		int contactsign = along < 0 ? -1 : 1;
+		if (n == 0) {
+			vertical = contactvertical;
+			sign = contactsign;
+		}
+		else if (contactvertical != vertical || contactsign != sign)
+			return false;
+	}
+	if (vertical)
+		*event = sign < 0 ? SwipeEventUp : SwipeEventDown;
+	else
+		*event = sign > 0 ? SwipeEventRight : SwipeEventLeft;
+	return true;
+}
+
+bool ProcessThreeFingerSwipe(PDEVICE_CONTEXT pDevice, csgesture_softc *sc, uint32_t active, int abovethreshold, int iToUse[3]) {
+	//reassert alt while the switcher shows; only a lost report is actually resent
+	if (sc->swipestate == SwipeStateSwitcher) {
 		BYTE shiftKeys = KBD_LALT_BIT;
 		BYTE keyCodes[KBD_KEY_CODES] = { 0, 0, 0, 0, 0, 0 };
 		update_keyboard(pDevice, shiftKeys, keyCodes);
 	}
 	if (abovethreshold == 3 || abovethreshold == 4) {
-		stop_scroll(pDevice);
-
 		int i1 = iToUse[0];
 		int delta_x1 = sc->x[i1] - sc->lastx[i1];
 		int delta_y1 = sc->y[i1] - sc->lasty[i1];
@@ -645,178 +1048,61 @@ bool ProcessThreeFingerSwipe(PDEVICE_CONTEXT pDevice, csgesture_softc *sc, int a
 		sc->multitaskingy += avgy;
 		sc->multitaskinggesturetick++;
 
-		if (sc->multitaskinggesturetick > 5 && !sc->multitaskingdone) {
-			if ((abs(delta_y1) + abs(delta_y2) + abs(delta_y3)) > (abs(delta_x1) + abs(delta_x2) + abs(delta_x3))) {
-				if (abs(sc->multitaskingy) > 15) {
-					if (sc->multitaskingy < 0) {
-						if (sc->alttabswitchershowing) {
-							for (int i = 0; i < 3; i++) {
-								sc->idsforalttab[i] = iToUse[i];
-							}
-
-							BYTE shiftKeys = KBD_LALT_BIT;
-							BYTE keyCodes[KBD_KEY_CODES] = { 0, 0, 0, 0, 0, 0 };
-							keyCodes[0] = 0x52; //Alt + Up
-							update_keyboard(pDevice, shiftKeys, keyCodes);
-							keyCodes[0] = 0x0;
-							update_keyboard(pDevice, shiftKeys, keyCodes);
-							sc->multitaskingx = 0;
-							sc->multitaskingy = 0;
-							sc->multitaskingdone = true;
-						} 
-						else if (abovethreshold == 3 && sc->settings.threeFingerSwipeUpGesture == SwipeUpGestureTaskView ||
-							abovethreshold == 4 && sc->settings.fourFingerSwipeUpGesture == SwipeUpGestureTaskView) {
-							if (abs(sc->multitaskingy) > 50) {
-								BYTE shiftKeys = KBD_LGUI_BIT;
-								BYTE keyCodes[KBD_KEY_CODES] = { 0, 0, 0, 0, 0, 0 };
-								keyCodes[0] = 0x2B; //Windows Key + Tab
-								update_keyboard(pDevice, shiftKeys, keyCodes);
-								shiftKeys = 0;
-								keyCodes[0] = 0x0;
-								update_keyboard(pDevice, shiftKeys, keyCodes);
-								sc->multitaskingx = 0;
-								sc->multitaskingy = 0;
-								sc->multitaskingdone = true;
-							}
-						}
-					}
-					else {
-						if (sc->alttabswitchershowing) {
-							for (int i = 0; i < 3; i++) {
-								sc->idsforalttab[i] = iToUse[i];
-							}
-
-							BYTE shiftKeys = KBD_LALT_BIT;
-							BYTE keyCodes[KBD_KEY_CODES] = { 0, 0, 0, 0, 0, 0 };
-							keyCodes[0] = 0x51; //Alt + Down
-							update_keyboard(pDevice, shiftKeys, keyCodes);
-							keyCodes[0] = 0x0;
-							update_keyboard(pDevice, shiftKeys, keyCodes);
-							sc->multitaskingx = 0;
-							sc->multitaskingy = 0;
-							sc->multitaskingdone = true;
-						}
-						else if (abovethreshold == 3 && sc->settings.threeFingerSwipeDownGesture == SwipeDownGestureShowDesktop ||
-							abovethreshold == 4 && sc->settings.fourFingerSwipeDownGesture == SwipeDownGestureShowDesktop) {
-							if (abs(sc->multitaskingy) > 50) {
-								BYTE shiftKeys = KBD_LGUI_BIT;
-								BYTE keyCodes[KBD_KEY_CODES] = { 0, 0, 0, 0, 0, 0 };
-								keyCodes[0] = 0x07;  //Windows Key + D
-								update_keyboard(pDevice, shiftKeys, keyCodes);
-								shiftKeys = 0;
-								keyCodes[0] = 0x0;
-								update_keyboard(pDevice, shiftKeys, keyCodes);
-								sc->multitaskingx = 0;
-								sc->multitaskingy = 0;
-								sc->multitaskingdone = true;
-							}
-						}
-					}
-				}
+		SwipeEvent coherentevent;
+		if (SwipeCoherent(sc, iToUse, &coherentevent)) {
+			if (sc->swipecoherentticks > 0 && sc->swipecoherentevent == coherentevent)
+				sc->swipecoherentticks++;
+			else
+				sc->swipecoherentticks = 1;
+			sc->swipecoherentevent = coherentevent;
+		}
+		else
+			sc->swipecoherentticks = 0;
+
+		//coherent motion skips the tick gate; the distance thresholds still apply
+		bool early = sc->swipecoherentticks >= SWIPE_COHERENT_TICKS;
+
+		if ((sc->multitaskinggesturetick > 5 || early) && !sc->multitaskingdone) {
+			SwipeEvent event;
+			int distance, start, commit;
+			if (early) {
+				event = sc->swipecoherentevent;
+				bool vertical = event == SwipeEventUp || event == SwipeEventDown;
+				distance = vertical ? abs(sc->multitaskingy) : abs(sc->multitaskingx);
+				start = vertical ? sc->thresholds.swipestarty : sc->thresholds.swipestartx;
+				commit = vertical ? sc->thresholds.swipecommity : sc->thresholds.swipecommitx;
+			}
+			else if ((abs(delta_y1) + abs(delta_y2) + abs(delta_y3)) > (abs(delta_x1) + abs(delta_x2) + abs(delta_x3))) {
+				event = sc->multitaskingy < 0 ? SwipeEventUp : SwipeEventDown;
+				distance = abs(sc->multitaskingy);
+				start = sc->thresholds.swipestarty;
+				commit = sc->thresholds.swipecommity;
 			}
 			else {
-				if (abs(sc->multitaskingx) > 15) {
-					if (sc->multitaskingx > 0) {
-						if ((abovethreshold == 3 && sc->settings.threeFingerSwipeLeftRightGesture == SwipeGestureSwitchWorkspace ||
-							abovethreshold == 4 && sc->settings.fourFingerSwipeLeftRightGesture == SwipeGestureSwitchWorkspace) &&
-							!sc->alttabswitchershowing) {
-							if (abs(sc->multitaskingx) > 50) {
-								BYTE shiftKeys = KBD_LGUI_BIT | KBD_LCONTROL_BIT;
-								BYTE keyCodes[KBD_KEY_CODES] = { 0, 0, 0, 0, 0, 0 };
-								keyCodes[0] = 0x50; //Ctrl + Windows Key + Left
-								update_keyboard(pDevice, shiftKeys, keyCodes);
-								shiftKeys = 0;
-								keyCodes[0] = 0x0;
-								update_keyboard(pDevice, shiftKeys, keyCodes);
-								sc->multitaskingx = 0;
-								sc->multitaskingy = 0;
-								sc->multitaskingdone = true;
-							}
-						}
-						else if (abovethreshold == 3 && sc->settings.threeFingerSwipeLeftRightGesture == SwipeGestureAltTabSwitcher ||
-							abovethreshold == 4 && sc->settings.fourFingerSwipeLeftRightGesture == SwipeGestureAltTabSwitcher ||
-							sc->alttabswitchershowing) {
-							for (int i = 0; i < 3; i++) {
-								sc->idsforalttab[i] = iToUse[i];
-							}
-
-							if (!sc->alttabswitchershowing) {
-								BYTE shiftKeys = KBD_LALT_BIT;
-								BYTE keyCodes[KBD_KEY_CODES] = { 0, 0, 0, 0, 0, 0 };
-								keyCodes[0] = 0x2B; //Alt + Tab
-								update_keyboard(pDevice, shiftKeys, keyCodes);
-								shiftKeys = KBD_LALT_BIT;
-								keyCodes[0] = 0x0;
-								update_keyboard(pDevice, shiftKeys, keyCodes);
-								sc->multitaskingx = 0;
-								sc->multitaskingy = 0;
-								sc->multitaskingdone = true;
-								sc->alttabswitchershowing = true;
-							}
-							else {
-								BYTE shiftKeys = KBD_LALT_BIT;
-								BYTE keyCodes[KBD_KEY_CODES] = { 0, 0, 0, 0, 0, 0 };
-								keyCodes[0] = 0x4F; //Alt + Right
-								update_keyboard(pDevice, shiftKeys, keyCodes);
-								keyCodes[0] = 0x0;
-								update_keyboard(pDevice, shiftKeys, keyCodes);
-								sc->multitaskingx = 0;
-								sc->multitaskingy = 0;
-								sc->multitaskingdone = true;
-							}
-						}
-					}
-					else {
-						if ((abovethreshold == 3 && sc->settings.threeFingerSwipeLeftRightGesture == SwipeGestureSwitchWorkspace ||
-							abovethreshold == 4 && sc->settings.fourFingerSwipeLeftRightGesture == SwipeGestureSwitchWorkspace) &&
-							!sc->alttabswitchershowing) {
-							if (abs(sc->multitaskingx) > 50) {
-								BYTE shiftKeys = KBD_LGUI_BIT | KBD_LCONTROL_BIT;
-								BYTE keyCodes[KBD_KEY_CODES] = { 0, 0, 0, 0, 0, 0 };
-								keyCodes[0] = 0x4F; //Ctrl + Windows Key + Right
-								update_keyboard(pDevice, shiftKeys, keyCodes);
-								shiftKeys = 0;
-								keyCodes[0] = 0x0;
-								update_keyboard(pDevice, shiftKeys, keyCodes);
-								sc->multitaskingx = 0;
-								sc->multitaskingy = 0;
-								sc->multitaskingdone = true;
-							}
-						}
-						else if (abovethreshold == 3 && sc->settings.threeFingerSwipeLeftRightGesture == SwipeGestureAltTabSwitcher ||
-							abovethreshold == 4 && sc->settings.fourFingerSwipeLeftRightGesture == SwipeGestureAltTabSwitcher ||
-							sc->alttabswitchershowing) {
-							for (int i = 0; i < 3; i++) {
-								sc->idsforalttab[i] = iToUse[i];
-							}
-
-							if (!sc->alttabswitchershowing) {
-								BYTE shiftKeys = KBD_LALT_BIT | KBD_LSHIFT_BIT;
-								BYTE keyCodes[KBD_KEY_CODES] = { 0, 0, 0, 0, 0, 0 };
-								keyCodes[0] = 0x2B; //Alt + Shift + Tab
-								update_keyboard(pDevice, shiftKeys, keyCodes);
-								shiftKeys = KBD_LALT_BIT;
-								keyCodes[0] = 0x0;
-								update_keyboard(pDevice, shiftKeys, keyCodes);
-								sc->multitaskingx = 0;
-								sc->multitaskingy = 0;
-								sc->multitaskingdone = true;
-								sc->alttabswitchershowing = true;
-							}
-							else {
-								BYTE shiftKeys = KBD_LALT_BIT;
-								BYTE keyCodes[KBD_KEY_CODES] = { 0, 0, 0, 0, 0, 0 };
-								keyCodes[0] = 0x50; //Alt + Left
-								update_keyboard(pDevice, shiftKeys, keyCodes);
-								keyCodes[0] = 0x0;
-								update_keyboard(pDevice, shiftKeys, keyCodes);
-								sc->multitaskingx = 0;
-								sc->multitaskingy = 0;
-								sc->multitaskingdone = true;
-							}
-						}
+				event = sc->multitaskingx > 0 ? SwipeEventRight : SwipeEventLeft;
+				distance = abs(sc->multitaskingx);
+				start = sc->thresholds.swipestartx;
+				commit = sc->thresholds.swipecommitx;
+			}
+
+			const csgesture_swipe_action *action = &sc->swipeactions[sc->swipestate][abovethreshold - 3][event];
+			if (action->keyCode && distance > (action->commit ? commit : start)) {
+				if (action->nextState == SwipeStateSwitcher) {
+					for (int i = 0; i < 3; i++) {
+						sc->idsforalttab[i] = iToUse[i];
 					}
 				}
+
+				BYTE keyCodes[KBD_KEY_CODES] = { 0, 0, 0, 0, 0, 0 };
+				keyCodes[0] = action->keyCode;
+				update_keyboard(pDevice, action->shiftKeys, keyCodes);
+				keyCodes[0] = 0x0;
+				update_keyboard(pDevice, action->holdKeys, keyCodes);
+				sc->multitaskingx = 0;
+				sc->multitaskingy = 0;
+				sc->multitaskingdone = true;
+				sc->swipecoherentticks = 0;
+				sc->swipestate = action->nextState;
 			}
 		}
 		else if (sc->multitaskinggesturetick > 25) {
@@ -828,26 +1114,17 @@ bool ProcessThreeFingerSwipe(PDEVICE_CONTEXT pDevice, csgesture_softc *sc, int a
 		return true;
 	}
 	else {
-		if (sc->alttabswitchershowing) {
-			bool foundTouch = false;
-			for (int i = 0; i < MAX_FINGERS; i++) {
-				if (foundTouch)
-					break;
-				if (sc->x[i] == -1)
-					continue;
-				for (int j = 0; j < 3; j++) {
-					if (i = sc->idsforalttab[j]) {
-						foundTouch = true;
-						break;
-					}
-				}
-			}
+		if (sc->swipestate == SwipeStateSwitcher) {
+			uint32_t alttabmask = 0;
+			for (int j = 0; j < 3; j++)
+				alttabmask |= contactbit(sc->idsforalttab[j]);
+			bool foundTouch = (active & alttabmask) != 0;
 			if (!foundTouch) {
 				BYTE shiftKeys = 0;
 				BYTE keyCodes[KBD_KEY_CODES] = { 0, 0, 0, 0, 0, 0 };
 				keyCodes[0] = 0x0;
 				update_keyboard(pDevice, shiftKeys, keyCodes);
-				sc->alttabswitchershowing = false;
+				sc->swipestate = SwipeStateIdle;
 				for (int i = 0; i < 3; i++) {
 					sc->idsforalttab[i] = -1;
 				}
@@ -857,16 +1134,22 @@ bool ProcessThreeFingerSwipe(PDEVICE_CONTEXT pDevice, csgesture_softc *sc, int a
 		sc->multitaskingy = 0;
 		sc->multitaskinggesturetick = 0;
 		sc->multitaskingdone = false;
+		sc->swipecoherentticks = 0;
 		return false;
 	}
 }
 
-void TapToClickOrDrag(PDEVICE_CONTEXT pDevice, csgesture_softc *sc, int button) {
-	if (!sc->settings.tapToClickEnabled)
-		return;
-	sc->tickssinceclick++;
+//true when feature is compiled in and, for the runtime build, enabled in the settings
+#define FEATURE(feature, setting) \
+	((Features & (feature)) != 0 && ((Features & CSGESTURE_FEATURE_RUNTIME) == 0 || (setting)))
+
+//slots the engine looks at for a given finger count
+#define FINGER_SLOTS(fingers) ((fingers) >= 32 ? 0xffffffffU : ((1U << (fingers)) - 1))
+
+template<int Fingers, unsigned Features>
+static void TapToClickOrDrag(PDEVICE_CONTEXT pDevice, csgesture_softc *sc, int button) {
 	if (sc->mouseDownDueToTap && sc->idForMouseDown == -1) {
-		if (sc->tickssinceclick > 10) {
+		if (sc->now - sc->taptime > (uint32_t)sc->settings.tapDragWindow) {
 			sc->mouseDownDueToTap = false;
 			sc->mousedown = false;
 			sc->buttonmask = 0;
@@ -874,26 +1157,14 @@ void TapToClickOrDrag(PDEVICE_CONTEXT pDevice, csgesture_softc *sc, int button)
 		}
 		return;
 	}
-	if (sc->mousedown) {
-		sc->tickssinceclick = 0;
+	if (sc->mousedown)
 		return;
-	}
-
-	for (int i = 0; i < MAX_FINGERS; i++) {
-		if (sc->truetick[i] < 10 && sc->truetick[i] > 0)
-			button++;
-	}
 
 	if (button == 0)
 		return;
 
 	int buttonmask = 0;
 
-	if (sc->scrollInertiaActive) {
-		stop_scroll(pDevice);
-		return;
-	}
-
 	switch (button) {
 	case 1:
 		if (!sc->settings.swapLeftRightFingers)
@@ -902,7 +1173,7 @@ void TapToClickOrDrag(PDEVICE_CONTEXT pDevice, csgesture_softc *sc, int button)
 			buttonmask = MOUSE_BUTTON_2;
 		break;
 	case 2:
-		if (sc->settings.multiFingerTap) {
+		if (FEATURE(CSGESTURE_FEATURE_MULTITAP, sc->settings.multiFingerTap)) {
 			if (!sc->settings.swapLeftRightFingers)
 				buttonmask = MOUSE_BUTTON_2;
 			else
@@ -910,7 +1181,7 @@ void TapToClickOrDrag(PDEVICE_CONTEXT pDevice, csgesture_softc *sc, int button)
 		}
 		break;
 	case 3:
-		if (sc->settings.multiFingerTap) {
+		if (Fingers >= 3 && FEATURE(CSGESTURE_FEATURE_MULTITAP, sc->settings.multiFingerTap)) {
 			if (sc->settings.threeFingerTapAction == ThreeFingerTapActionWheelClick)
 				buttonmask = MOUSE_BUTTON_3;
 			else if (sc->settings.threeFingerTapAction == ThreeFingerTapActionCortana) {
@@ -927,7 +1198,7 @@ void TapToClickOrDrag(PDEVICE_CONTEXT pDevice, csgesture_softc *sc, int button)
 		}
 		break;
 	case 4:
-		if (sc->settings.fourFingerTapEnabled) {
+		if (Fingers >= 4 && FEATURE(CSGESTURE_FEATURE_FOURTAP, sc->settings.fourFingerTapEnabled)) {
 			buttonmask = 0;
 
 			BYTE shiftKeys = KBD_LGUI_BIT;
@@ -940,19 +1211,27 @@ void TapToClickOrDrag(PDEVICE_CONTEXT pDevice, csgesture_softc *sc, int button)
 		}
 		break;
 	}
-	if (buttonmask != 0 && sc->tickssinceclick > 10 && sc->ticksincelastrelease == 0) {
+	if (buttonmask == 0)
+		return;
+
+	if (button == 1 && FEATURE(CSGESTURE_FEATURE_TAPDRAG, sc->settings.tapDragEnabled)) {
+		//hold the button for a touch that may follow to drag
 		sc->idForMouseDown = -1;
 		sc->mouseDownDueToTap = true;
 		sc->buttonmask = buttonmask;
 		sc->mousebutton = button;
 		sc->mousedown = true;
-		sc->tickssinceclick = 0;
+		sc->taptime = sc->frametime;
+	}
+	else {
+		//nothing can follow, click with this frame's report
+		sc->tapclick = buttonmask;
 	}
 }
 
 void ClearTapDrag(PDEVICE_CONTEXT pDevice, csgesture_softc *sc, int i) {
 	if (i == sc->idForMouseDown && sc->mouseDownDueToTap == true) {
-		if (sc->tick[i] < 10) {
+		if (sc->frametime - sc->downtime[i] <= (uint32_t)sc->settings.tapWindow) {
 			//Double Tap
 			update_relative_mouse(pDevice, 0, 0, 0, 0, 0);
 			update_relative_mouse(pDevice, sc->buttonmask, 0, 0, 0, 0);
@@ -961,14 +1240,275 @@ void ClearTapDrag(PDEVICE_CONTEXT pDevice, csgesture_softc *sc, int i) {
 		sc->mousedown = false;
 		sc->buttonmask = 0;
 		sc->idForMouseDown = -1;
+		sc->tapvalid = false;
 		//Clear Tap Drag
 	}
 }
 
-void ProcessGesture(PDEVICE_CONTEXT pDevice, csgesture_softc *sc) {
+#define PRESSURE_ONSET_TICKS	3
+#define PRESSURE_BRUSH_PEAK		8
+#define PRESSURE_FIRM_PEAK		20
+#define PRESSURE_TAP_ONSET		4
+#define PRESSURE_HARD_STEADY	80
+
+static PressureClass ClassifyPressure(csgesture_softc *sc, int i) {
+	if (sc->quirks & CSGESTURE_QUIRK_NO_PRESSURE)
+		return PressureClassTap;
+	if (sc->pressurepeak[i] < PRESSURE_BRUSH_PEAK)
+		return PressureClassBrush;
+	if ((sc->pressuresteady[i] >> 4) >= PRESSURE_HARD_STEADY)
+		return PressureClassHard;
+	//a deliberate tap lands fast; a slow, light landing is a finger brushing past
+	if (sc->pressureonset[i] < PRESSURE_TAP_ONSET && sc->pressurepeak[i] < PRESSURE_FIRM_PEAK)
+		return PressureClassBrush;
+	return PressureClassTap;
+}
+
+void UpdatePressureModel(csgesture_softc *sc, uint32_t active) {
+	for (uint32_t m = active; m; m &= m - 1) {
+		int i = firstcontact(m);
+		int p = sc->p[i];
+		if (sc->truetick[i] < PRESSURE_ONSET_TICKS) {
+			int rise = p - (sc->lastp[i] < 0 ? 0 : sc->lastp[i]);
+			if (rise > sc->pressureonset[i])
+				sc->pressureonset[i] = rise;
+		}
+		if (p > sc->pressurepeak[i])
+			sc->pressurepeak[i] = p;
+		if (sc->truetick[i] == 0)
+			sc->pressuresteady[i] = p << 4;
+		else
+			sc->pressuresteady[i] += ((p << 4) - sc->pressuresteady[i]) / 4;
+
+		sc->pressureclass[i] = ClassifyPressure(sc, i);
+	}
+}
+
+//
+// Resting contacts: a contact that sits still in the thumb zone while a
+// working contact above the zone is down is a thumb or finger parked on the
+// click area. It is left out of pointer ownership, gestures and finger counts
+// until it lifts or starts to move. Contacts that are all in the zone are left
+// alone, so two fingers there still right click and scroll. Wide contacts are
+// taken for thumbs after a shorter dwell.
+//
+#define RESTING_DWELL_MS		250
+#define RESTING_WIDE_DWELL_MS	60
+
+static bool IsMoving(csgesture_softc *sc, int i) {
+	int avgx = window_average(&sc->motionx[i]);
+	int avgy = window_average(&sc->motiony[i]);
+	return distancesq(avgx, avgy) > sc->thresholds.motionsq;
+}
+
+static bool IsResting(csgesture_softc *sc, int i) {
+	if (sc->newmask & contactbit(i))
+		return false;
+	if (sc->panningActive && sc->idForPanning == i)
+		return false;
+	if (sc->y[i] <= sc->resy - sc->thresholds.thumbzone)
+		return false;
+
+	if (IsMoving(sc, i))
+		return false;
+
+	uint32_t dwell = RESTING_DWELL_MS;
+	if (!(sc->quirks & CSGESTURE_QUIRK_NO_CONTACT_SIZE) && sc->major[i] > sc->thresholds.restmajor)
+		dwell = RESTING_WIDE_DWELL_MS;
+	return sc->frametime - sc->downtime[i] >= dwell;
+}
+
+void UpdateRestingContacts(csgesture_softc *sc, uint32_t active) {
+	//a resting contact that starts moving takes part again
+	for (uint32_t m = active & sc->restingmask; m; m &= m - 1) {
+		int i = firstcontact(m);
+		if (IsMoving(sc, i))
+			sc->restingmask &= ~contactbit(i);
+	}
+
+	//only a working contact above the zone makes the others resting
+	bool working = false;
+	for (uint32_t m = active & ~sc->restingmask; m; m &= m - 1) {
+		int i = firstcontact(m);
+		if (sc->y[i] <= sc->resy - sc->thresholds.thumbzone)
+			working = true;
+	}
+	if (!working)
+		return;
+
+	for (uint32_t m = active & ~sc->restingmask; m; m &= m - 1) {
+		int i = firstcontact(m);
+		if (IsResting(sc, i))
+			sc->restingmask |= contactbit(i);
+	}
+}
+
+//
+// Pointer acceleration is a speed-to-gain curve resolved into a table of
+// per-axis counts per sensor unit whenever the settings or resolution change.
+// The sub-count part of each frame's motion is carried to the next frame.
+//
+#define ACCEL_SHIFT 24
+#define ACCEL_MAX_MULTIPLIER 100 //pointerMultiplier, keeps every table entry within int
+
+void SetPointerCurve(csgesture_softc *sc) {
+	if (sc->unitspermmx == 0 || sc->unitspermmy == 0)
+		return;
+
+	int accelstep = (sc->unitspermmx + sc->unitspermmy) / 20;
+	if (accelstep == 0)
+		accelstep = 1;
+	sc->accelscale = (1 << CSGESTURE_RECIP_SHIFT) / accelstep;
+
+	int multiplier = min(max(sc->settings.pointerMultiplier, 0), ACCEL_MAX_MULTIPLIER);
+	int accelmax = max(sc->settings.accelMax, 100);
+
+	for (int step = 0; step < ACCEL_STEPS; step++) {
+		int64_t gain = 100;
+		if (step > sc->settings.accelThreshold)
+			gain += (int64_t)sc->settings.accelRate * (step - sc->settings.accelThreshold);
+		if (gain > accelmax)
+			gain = accelmax;
+		else if (gain < 100)
+			gain = 100;
+
+		int64_t counts = (int64_t)multiplier * gain << ACCEL_SHIFT;
+		sc->accelx[step] = (int)(counts / (100 * (int64_t)sc->unitspermmx));
+		sc->accely[step] = (int)(counts / (100 * (int64_t)sc->unitspermmy));
+	}
+	sc->accelremx = 0;
+	sc->accelremy = 0;
+}
+
+static int accel_axis(int delta, int factor, int *remainder) {
+	//never carry motion across a reversal
+	if ((delta < 0 && *remainder > 0) || (delta > 0 && *remainder < 0))
+		*remainder = 0;
+
+	int64_t scaled = (int64_t)delta * factor + *remainder;
+	int counts = (int)(scaled / (1 << ACCEL_SHIFT));
+	*remainder = (int)(scaled - ((int64_t)counts << ACCEL_SHIFT));
+
+	//a report carries the whole frame; only beyond its 16 bit range is motion lost
+	if (counts > RELATIVE_MOUSE_MAX_COORDINATE)
+		counts = RELATIVE_MOUSE_MAX_COORDINATE;
+	else if (counts < RELATIVE_MOUSE_MIN_COORDINATE)
+		counts = RELATIVE_MOUSE_MIN_COORDINATE;
+	return counts;
+}
+
+//
+// Soft buttons: the bottom softButtonHeight of the pad is split into left,
+// middle and right regions, precomputed into SOFTBUTTON_COLUMNS columns so the
+// press resolves with one lookup. A middle width of 0 leaves left and right
+// halves.
+//
+static int um_to_units(int val, int unitspermm) {
+	return (int)((int64_t)val * unitspermm / 1000);
+}
+
+void SetSoftButtons(csgesture_softc *sc) {
+	if (sc->resx == 0 || sc->unitspermmx == 0 || sc->unitspermmy == 0)
+		return;
+
+	uint8_t primary = sc->settings.swapLeftRightFingers ? MOUSE_BUTTON_2 : MOUSE_BUTTON_1;
+	uint8_t secondary = sc->settings.swapLeftRightFingers ? MOUSE_BUTTON_1 : MOUSE_BUTTON_2;
+
+	int middle = min(um_to_units(sc->settings.softButtonMiddleWidth, sc->unitspermmx), sc->resx);
+	int left = (sc->resx - middle) / 2;
+	int right = left + middle;
+
+	for (int col = 0; col < SOFTBUTTON_COLUMNS; col++) {
+		int x = (int)(((int64_t)col * 2 + 1) * sc->resx / (2 * SOFTBUTTON_COLUMNS));
+		if (x < left)
+			sc->softbuttons[col] = primary;
+		else if (x >= right)
+			sc->softbuttons[col] = secondary;
+		else
+			sc->softbuttons[col] = MOUSE_BUTTON_3;
+	}
+	sc->softbuttonscale = (int)(((int64_t)SOFTBUTTON_COLUMNS << CSGESTURE_RECIP_SHIFT) / sc->resx);
+	sc->softbuttontop = sc->resy - um_to_units(sc->settings.softButtonHeight, sc->unitspermmy);
+}
+
+static int SoftButtonAt(csgesture_softc *sc, int i) {
+	int col = (int)((int64_t)sc->x[i] * sc->softbuttonscale >> CSGESTURE_RECIP_SHIFT);
+	if (col >= SOFTBUTTON_COLUMNS)
+		col = SOFTBUTTON_COLUMNS - 1;
+	return sc->softbuttons[col];
+}
+
+//
+// The contact pushing the button is the one whose pressure rose most on the
+// press frame, resting or not. Without a usable rise it is the lowest one,
+// and only an exact tie goes to the most recent landing.
+//
+static int PressingContact(csgesture_softc *sc, uint32_t active) {
+	bool pressure = !(sc->quirks & CSGESTURE_QUIRK_NO_PRESSURE);
+
+	int pressing = -1;
+	int bestrise = 0;
+	for (uint32_t m = active; m; m &= m - 1) {
+		int i = firstcontact(m);
+		int rise = 0;
+		if (pressure && sc->lastp[i] != -1)
+			rise = max(sc->p[i] - sc->lastp[i], 0);
+
+		bool better;
+		if (pressing == -1 || rise != bestrise)
+			better = pressing == -1 || rise > bestrise;
+		else if (sc->y[i] != sc->y[pressing])
+			better = sc->y[i] > sc->y[pressing];
+		else
+			better = sc->truetick[i] < sc->truetick[pressing];
+
+		if (better) {
+			pressing = i;
+			bestrise = rise;
+		}
+	}
+	return pressing;
+}
+
+static void AcceleratePointer(csgesture_softc *sc, int *dx, int *dy) {
+	if (sc->accelscale == 0) {
+		*dx = 0;
+		*dy = 0;
+		return;
+	}
+
+	//octagonal approximation of the speed, within 12%
+	int ax = abs(sc->dx);
+	int ay = abs(sc->dy);
+	int speed = max(ax, ay) + min(ax, ay) / 2;
+
+	int step = (int)((int64_t)speed * sc->accelscale >> CSGESTURE_RECIP_SHIFT);
+	if (step >= ACCEL_STEPS)
+		step = ACCEL_STEPS - 1;
+
+	*dx = accel_axis(sc->dx, sc->accelx[step], &sc->accelremx);
+	*dy = accel_axis(sc->dy, sc->accely[step], &sc->accelremy);
+}
+
+template<int Fingers, unsigned Features>
+static void ProcessGestureEngine(PDEVICE_CONTEXT pDevice, csgesture_softc *sc) {
+	const uint32_t active = sc->activemask & FINGER_SLOTS(Fingers);
+
 #pragma mark reset inputs
 	sc->dx = 0;
 	sc->dy = 0;
+	sc->scrollx = 0;
+	sc->scrolly = 0;
+
+#pragma mark momentum scrolling
+	ProcessMomentum(sc);
+
+#pragma mark classify contact pressure
+	UpdatePressureModel(sc, active);
+
+#pragma mark detect resting contacts
+	UpdateRestingContacts(sc, active);
+	const uint32_t touching = active & ~sc->restingmask;
 
 #pragma mark process touch thresholds
 	int avgx[MAX_FINGERS];
@@ -976,57 +1516,49 @@ void ProcessGesture(PDEVICE_CONTEXT pDevice, csgesture_softc *sc) {
 
 	int abovethreshold = 0;
 	int recentlyadded = 0;
-	int lastrecentlyadded = -1;
 	int iToUse[3] = { -1,-1,-1 };
 	int a = 0;
 
-	int nfingers = 0;
-	for (int i = 0;i < MAX_FINGERS;i++) {
-		if (sc->x[i] != -1)
-			nfingers++;
-	}
+	int nfingers = contactcount(touching);
 
-	for (int i = 0;i < MAX_FINGERS;i++) {
-		if (sc->truetick[i] < 30 && sc->truetick[i] != 0) {
+	for (uint32_t m = touching; m; m &= m - 1) {
+		int i = firstcontact(m);
+		if (sc->truetick[i] < 30 && sc->truetick[i] != 0)
 			recentlyadded++;
-			lastrecentlyadded = i;
-		}
 		if (sc->tick[i] == 0)
 			continue;
-		if (sc->blacklistedids[i] == 1)
-			continue;
-		avgx[i] = sc->flextotalx[i] / sc->tick[i];
-		avgy[i] = sc->flextotaly[i] / sc->tick[i];
-		if (distancesq(avgx[i], avgy[i]) > 2) {
+		avgx[i] = window_average(&sc->motionx[i]);
+		avgy[i] = window_average(&sc->motiony[i]);
+		if (distancesq(avgx[i], avgy[i]) > sc->thresholds.motionsq) {
 			abovethreshold++;
-			iToUse[a] = i;
-			a++;
+			if (a < 3) {
+				iToUse[a] = i;
+				a++;
+			}
 		}
 	}
 
 #pragma mark process different gestures
+	ReleasePinchKeys(pDevice, sc);
+
 	bool handled = false;
 	bool handledByScroll = false;
-
-	if (!handled)
-		handled = ProcessThreeFingerSwipe(pDevice, sc, abovethreshold, iToUse);
+	bool handledBySwipe = false;
+
+	if (Fingers >= 3 && FEATURE(CSGESTURE_FEATURE_SWIPE, true) && !handled)
+		handledBySwipe = handled = ProcessThreeFingerSwipe(pDevice, sc, active, abovethreshold, iToUse);
+	if (Fingers >= 2 && FEATURE(CSGESTURE_FEATURE_PINCH, sc->settings.pinchEnabled) && !handled)
+		handledByScroll = handled = ProcessPinch(pDevice, sc, active, abovethreshold, iToUse);
+	if (Fingers >= 2 && FEATURE(CSGESTURE_FEATURE_SCROLL, sc->settings.scrollEnabled) && !handled)
+		handledByScroll = handled = ProcessScroll(pDevice, sc, active, abovethreshold, iToUse);
 	if (!handled)
-		handledByScroll = handled = ProcessScroll(pDevice, sc, abovethreshold, iToUse);
-	if (!handled)
-		handled = ProcessMove(pDevice, sc, abovethreshold, iToUse);
+		handled = ProcessMove(pDevice, sc, active, abovethreshold, iToUse);
 
 #pragma mark process clickpad press state
 	int buttonmask = 0;
 
 	sc->mousebutton = recentlyadded;
 
-	if (sc->settings.rightClickBottomRight) {
-		if (sc->mousebutton == 1 && lastrecentlyadded != -1) {
-			if (sc->x[lastrecentlyadded] > sc->resx / 2 && sc->y[lastrecentlyadded] > (sc->resy - 60))
-				sc->mousebutton = 2;
-		}
-	}
-
 	if (sc->mousebutton == 0)
 		sc->mousebutton = abovethreshold;
 
@@ -1035,7 +1567,8 @@ void ProcessGesture(PDEVICE_CONTEXT pDevice, csgesture_softc *sc) {
 			sc->mousebutton = 1;
 		else
 			sc->mousebutton = nfingers;
-		if (sc->mousebutton == 0 && sc->settings.clickWithNoFingers)
+		//a press with only resting contacts down is the thumb clicking
+		if (sc->mousebutton == 0 && (sc->settings.clickWithNoFingers || (active & sc->restingmask)))
 			sc->mousebutton = 1;
 	}
 	if (sc->mousebutton > 3)
@@ -1044,7 +1577,6 @@ void ProcessGesture(PDEVICE_CONTEXT pDevice, csgesture_softc *sc) {
 	if (!sc->mouseDownDueToTap) {
 		if (sc->buttondown && !sc->mousedown) {
 			sc->mousedown = true;
-			sc->tickssinceclick = 0;
 
 			switch (sc->mousebutton) {
 			case 1:
@@ -1054,7 +1586,7 @@ void ProcessGesture(PDEVICE_CONTEXT pDevice, csgesture_softc *sc) {
 					buttonmask = MOUSE_BUTTON_2;
 				break;
 			case 2:
-				if (sc->settings.multiFingerClick) {
+				if (FEATURE(CSGESTURE_FEATURE_MULTICLICK, sc->settings.multiFingerClick)) {
 					if (!sc->settings.swapLeftRightFingers)
 						buttonmask = MOUSE_BUTTON_2;
 					else
@@ -1062,11 +1594,17 @@ void ProcessGesture(PDEVICE_CONTEXT pDevice, csgesture_softc *sc) {
 				}
 				break;
 			case 3:
-				if (sc->settings.multiFingerClick) {
+				if (FEATURE(CSGESTURE_FEATURE_MULTICLICK, sc->settings.multiFingerClick)) {
 					buttonmask = MOUSE_BUTTON_3;
 				}
 				break;
 			}
+
+			if (FEATURE(CSGESTURE_FEATURE_BOTTOMRIGHT, sc->settings.rightClickBottomRight)) {
+				int pressing = PressingContact(sc, active);
+				if (pressing != -1 && sc->y[pressing] > sc->softbuttontop)
+					buttonmask = SoftButtonAt(sc, pressing);
+			}
 			sc->buttonmask = buttonmask;
 		}
 		else if (sc->mousedown && !sc->buttondown) {
@@ -1077,94 +1615,383 @@ void ProcessGesture(PDEVICE_CONTEXT pDevice, csgesture_softc *sc) {
 	}
 
 #pragma mark shift to last
-	int releasedfingers = 0;
-
-	for (int i = 0;i < MAX_FINGERS;i++) {
-		if (sc->x[i] != -1) {
-			if (sc->lastx[i] == -1) {
-				if (sc->ticksincelastrelease < 10 && sc->mouseDownDueToTap && sc->idForMouseDown == -1) {
-					if (sc->settings.tapDragEnabled)
+	for (uint32_t m = sc->activemask | sc->liftedmask; m; m &= m - 1) {
+		int i = firstcontact(m);
+		if (sc->activemask & contactbit(i)) {
+			if (sc->newmask & contactbit(i)) {
+				if (sc->mouseDownDueToTap && sc->idForMouseDown == -1 &&
+					sc->frametime - sc->taptime <= (uint32_t)sc->settings.tapDragWindow) {
+					if (FEATURE(CSGESTURE_FEATURE_TAPDRAG, sc->settings.tapDragEnabled))
 						sc->idForMouseDown = i; //Associate Tap Drag
 				}
+
+				sc->downtime[i] = sc->frametime;
+				sc->downx[i] = sc->x[i];
+				sc->downy[i] = sc->y[i];
+				if ((active & contactbit(i)) && (!sc->tapgroup || !(active & ~sc->restingmask & ~sc->newmask))) {
+					sc->tapgroup = true;
+					sc->tapvalid = true;
+					sc->tapfingers = 0;
+					sc->tapstart = sc->frametime;
+				}
 			}
+			else if ((active & ~sc->restingmask & contactbit(i)) &&
+				distancesq(sc->x[i] - sc->downx[i], sc->y[i] - sc->downy[i]) > sc->thresholds.taptravelsq)
+				sc->tapvalid = false;
 			sc->truetick[i]++;
-			if (sc->tick[i] < 10) {
-				if (sc->lastx[i] != -1) {
-					sc->totalx[i] += abs(sc->x[i] - sc->lastx[i]);
-					sc->totaly[i] += abs(sc->y[i] - sc->lasty[i]);
-					sc->totalp[i] += sc->p[i];
-
-					sc->flextotalx[i] = sc->totalx[i];
-					sc->flextotaly[i] = sc->totaly[i];
-
-					int j = sc->tick[i];
-					sc->xhistory[i][j] = abs(sc->x[i] - sc->lastx[i]);
-					sc->yhistory[i][j] = abs(sc->y[i] - sc->lasty[i]);
-				}
+			if (sc->tick[i] < 10)
 				sc->tick[i]++;
-			}
-			else if (sc->lastx[i] != -1) {
-				int absx = abs(sc->x[i] - sc->lastx[i]);
-				int absy = abs(sc->y[i] - sc->lasty[i]);
 
-				int newtotalx = sc->flextotalx[i] - sc->xhistory[i][0] + absx;
-				int newtotaly = sc->flextotaly[i] - sc->yhistory[i][0] + absy;
-
-				sc->totalx[i] += absx;
-				sc->totaly[i] += absy;
-
-				sc->flextotalx[i] -= sc->xhistory[i][0];
-				sc->flextotaly[i] -= sc->yhistory[i][0];
-				for (int j = 1;j < 10;j++) {
-					sc->xhistory[i][j - 1] = sc->xhistory[i][j];
-					sc->yhistory[i][j - 1] = sc->yhistory[i][j];
-				}
-				sc->flextotalx[i] += absx;
-				sc->flextotaly[i] += absy;
-
-				int j = 9;
-				sc->xhistory[i][j] = absx;
-				sc->yhistory[i][j] = absy;
+			//the landing tick contributes a zero sample so the average spans every tick present
+			int absx = 0;
+			int absy = 0;
+			if (sc->lastx[i] != -1) {
+				absx = abs(sc->x[i] - sc->lastx[i]);
+				absy = abs(sc->y[i] - sc->lasty[i]);
 			}
+			window_push(&sc->motionx[i], sc->settings.motionWindow, absx);
+			window_push(&sc->motiony[i], sc->settings.motionWindow, absy);
 		}
-		if (sc->x[i] == -1) {
+		else {
 			ClearTapDrag(pDevice, sc, i);
-			if (sc->lastx[i] != -1)
-				sc->ticksincelastrelease = -1;
-			for (int j = 0;j < 10;j++) {
-				sc->xhistory[i][j] = 0;
-				sc->yhistory[i][j] = 0;
+			window_reset(&sc->motionx[i]);
+			window_reset(&sc->motiony[i]);
+			if (sc->tick[i] != 0 && (FINGER_SLOTS(Fingers) & ~sc->restingmask & contactbit(i))) {
+				if (sc->pressureclass[i] != PressureClassBrush && !(sc->momentumstopmask & contactbit(i)))
+					sc->tapfingers++;
 			}
-			if (sc->tick[i] < 10 && sc->tick[i] != 0) {
-				int avgp = sc->totalp[i] / sc->tick[i];
-				if (avgp > 7)
-					releasedfingers++;
-			}
-			sc->totalx[i] = 0;
-			sc->totaly[i] = 0;
-			sc->totalp[i] = 0;
+			sc->pressurepeak[i] = 0;
+			sc->pressureonset[i] = 0;
+			sc->pressuresteady[i] = 0;
+			sc->pressureclass[i] = PressureClassNone;
 			sc->tick[i] = 0;
 			sc->truetick[i] = 0;
 
-			sc->blacklistedids[i] = 0;
+			sc->restingmask &= ~contactbit(i);
+			sc->momentumstopmask &= ~contactbit(i);
 
 			if (sc->idForPanning == i) {
 				sc->panningActive = false;
 				sc->idForPanning = -1;
 			}
+			//drop any lead rather than pull the cursor back on lift
+			if (sc->predictid == i)
+				ResetPrediction(sc, -1);
 		}
 		sc->lastx[i] = sc->x[i];
 		sc->lasty[i] = sc->y[i];
 		sc->lastp[i] = sc->p[i];
 	}
-	sc->ticksincelastrelease++;
+
+#pragma mark track taps
+	//after the landings above, so a group started this frame is also invalidated
+	if (handledByScroll || handledBySwipe || sc->buttondown)
+		sc->tapvalid = false;
+
+	//a tap is decided as soon as its last finger lifts
+	int tappedfingers = 0;
+	if (sc->tapgroup && (active & ~sc->restingmask) == 0) {
+		uint32_t window = sc->tapfingers > 1 ? sc->settings.multiTapWindow : sc->settings.tapWindow;
+		if (sc->tapvalid && sc->frametime - sc->tapstart <= window)
+			tappedfingers = sc->tapfingers;
+		sc->tapgroup = false;
+	}
 
 #pragma mark process tap to click
-	if (!handledByScroll)
-		TapToClickOrDrag(pDevice, sc, releasedfingers);
+	if (FEATURE(CSGESTURE_FEATURE_TAP, sc->settings.tapToClickEnabled) && !handledByScroll)
+		TapToClickOrDrag<Fingers, Features>(pDevice, sc, tappedfingers);
 
 #pragma mark send to system
-	update_relative_mouse(pDevice, sc->buttonmask, sc->dx, sc->dy, sc->scrolly, sc->scrollx);
+	//the press of a tap click is kept until delivered; the frame's report releases it
+	if (sc->tapclick && update_relative_mouse(pDevice, sc->buttonmask | sc->tapclick, 0, 0, 0, 0))
+		sc->tapclick = 0;
+
+	int dx, dy;
+	AcceleratePointer(sc, &dx, &dy);
+	update_relative_mouse(pDevice, sc->buttonmask, dx, dy, sc->scrolly, sc->scrollx);
+}
+
+#undef FEATURE
+
+void ProcessGesture(PDEVICE_CONTEXT pDevice, csgesture_softc *sc) {
+	ULONG64 start = __rdtsc();
+
+	ProcessGestureEngine<CSGESTURE_ENGINE_FINGERS, CSGESTURE_ENGINE_FEATURES>(pDevice, sc);
+
+	pDevice->GestureCycles += __rdtsc() - start;
+	pDevice->GestureFrames++;
+}
+
+static bool IsPalmOrThumb(csgesture_softc *sc, int i) {
+	if (sc->quirks & CSGESTURE_QUIRK_NO_CONTACT_SIZE)
+		return false;
+
+	if (sc->major[i] > sc->thresholds.palmmajor)
+		return true;
+
+	//a resting thumb is wide and parked along the bottom edge, but never steals the pointer
+	if (sc->major[i] > sc->thresholds.thumbmajor &&
+		sc->y[i] > sc->resy - sc->thresholds.thumbzone &&
+		!(sc->panningActive && sc->idForPanning == i))
+		return true;
+	return false;
+}
+
+uint32_t RejectPalms(csgesture_softc *sc, uint32_t contacts) {
+	sc->rejectedmask &= contacts;
+
+	for (uint32_t m = contacts; m; m &= m - 1) {
+		int i = firstcontact(m);
+		if (!(sc->rejectedmask & contactbit(i)) && IsPalmOrThumb(sc, i)) {
+			//forget the contact's history so hiding it does not read as a tap release
+			sc->rejectedmask |= contactbit(i);
+			sc->lastx[i] = -1;
+			sc->lasty[i] = -1;
+			sc->tick[i] = 0;
+			sc->truetick[i] = 0;
+		}
+
+		if (sc->rejectedmask & contactbit(i)) {
+			sc->x[i] = -1;
+			sc->y[i] = -1;
+			sc->p[i] = -1;
+		}
+	}
+	return contacts & ~sc->rejectedmask;
+}
+
+//
+// 1 euro filter: a low pass whose cutoff rises with the contact's speed, so a
+// resting finger is smoothed heavily while fast motion passes with little lag.
+// One sample per timer tick; alphas are Q12.
+//
+#define FILTER_DCUTOFF		1000 //mHz
+#define FILTER_ALPHA_SHIFT	12
+#define FILTER_MAX_CUTOFF	1000000 //mHz, alpha is within 2% of passing straight through
+#define FILTER_MAX_BETA		100000 //mHz per mm/s
+
+static int filter_alpha(int cutoff) {
+	if (cutoff <= 0)
+		return 0;
+	//x = 2 pi fc Te in Q16, alpha = x / (1 + x)
+	int64_t x = (int64_t)cutoff * GESTURE_TICK_MS * 411775 / 1000000;
+	return (int)((x << FILTER_ALPHA_SHIFT) / (x + 65536));
+}
+
+static int filter_step(csgesture_filter *f, int value, int speedrecip, csgesture_settings *settings) {
+	if (!f->primed) {
+		f->value = value;
+		f->velocity = 0;
+		f->primed = true;
+		return value;
+	}
+	int delta = value - f->value;
+	f->velocity += (int)((int64_t)(delta - f->velocity) * filter_alpha(FILTER_DCUTOFF) / (1 << FILTER_ALPHA_SHIFT));
+
+	int speed = (int)((int64_t)abs(f->velocity) * speedrecip >> CSGESTURE_RECIP_SHIFT); //mm/s
+	int64_t cutoff = settings->filterMinCutoff + (int64_t)settings->filterBeta * speed;
+	if (cutoff > FILTER_MAX_CUTOFF)
+		cutoff = FILTER_MAX_CUTOFF;
+	else if (cutoff < settings->filterMinCutoff)
+		cutoff = settings->filterMinCutoff;
+	f->value += (int)((int64_t)delta * filter_alpha((int)cutoff) / (1 << FILTER_ALPHA_SHIFT));
+	return f->value;
+}
+
+//
+// Each contact's step is checked against the step its last velocity predicts.
+// An error beyond the contact's own speed plus a fixed tolerance is not
+// something a finger can do in one tick, so the contact is held on its
+// predicted path instead. A contact that stays off its path for
+// OUTLIER_REBASE ticks, or any outlier in a frame where another contact lifted
+// or landed (the firmware may have reassigned slots), is taken as having
+// moved there and restarts from its new position without motion.
+//
+#define OUTLIER_REBASE 3
+
+static bool outlier_step(int step, int velocity, int tolerance) {
+	return abs(step - velocity) > tolerance + abs(velocity);
+}
+
+void RejectOutliers(csgesture_softc *sc) {
+	bool slotschanged = (sc->newmask | sc->liftedmask) != 0;
+
+	for (uint32_t m = sc->activemask; m; m &= m - 1) {
+		int i = firstcontact(m);
+		int x = sc->x[i];
+		int y = sc->y[i];
+
+		if (sc->newmask & contactbit(i)) {
+			sc->rawx[i] = x;
+			sc->rawy[i] = y;
+			sc->rawvx[i] = 0;
+			sc->rawvy[i] = 0;
+			sc->outliers[i] = 0;
+			continue;
+		}
+
+		int stepx = x - sc->rawx[i];
+		int stepy = y - sc->rawy[i];
+		if (outlier_step(stepx, sc->rawvx[i], sc->thresholds.outlierx) ||
+			outlier_step(stepy, sc->rawvy[i], sc->thresholds.outliery)) {
+			sc->outliers[i]++;
+			if (slotschanged || sc->outliers[i] >= OUTLIER_REBASE) {
+				//accept the new position without motion
+				sc->rawx[i] = x;
+				sc->rawy[i] = y;
+				sc->rawvx[i] = 0;
+				sc->rawvy[i] = 0;
+				sc->outliers[i] = 0;
+				sc->lastx[i] = x;
+				sc->lasty[i] = y;
+				sc->filterx[i].primed = false;
+				sc->filtery[i].primed = false;
+				continue;
+			}
+			//hold the contact on its predicted path
+			sc->rawx[i] += sc->rawvx[i];
+			sc->rawy[i] += sc->rawvy[i];
+			sc->x[i] = sc->rawx[i];
+			sc->y[i] = sc->rawy[i];
+			continue;
+		}
+
+		sc->rawvx[i] = stepx;
+		sc->rawvy[i] = stepy;
+		sc->rawx[i] = x;
+		sc->rawy[i] = y;
+		sc->outliers[i] = 0;
+	}
+}
+
+void FilterContacts(csgesture_softc *sc) {
+	for (uint32_t m = sc->liftedmask; m; m &= m - 1) {
+		int i = firstcontact(m);
+		sc->filterx[i].primed = false;
+		sc->filtery[i].primed = false;
+	}
+	if (sc->settings.filterMinCutoff <= 0)
+		return;
+	for (uint32_t m = sc->activemask; m; m &= m - 1) {
+		int i = firstcontact(m);
+		sc->x[i] = filter_step(&sc->filterx[i], sc->x[i], sc->thresholds.speedx, &sc->settings);
+		sc->y[i] = filter_step(&sc->filtery[i], sc->y[i], sc->thresholds.speedy, &sc->settings);
+	}
+}
+
+void UpdateContactMasks(csgesture_softc *sc, uint32_t active) {
+	sc->newmask = active & ~sc->activemask;
+	sc->liftedmask = sc->activemask & ~active;
+	sc->activemask = active;
+}
+
+//
+// Contact tracking: the firmware may move a finger to another slot between
+// frames, so slots are matched to persistent contact ids by distance to each
+// id's predicted position. Every pick scans the remaining slot/id pairs, and
+// there are at most MAX_FINGERS picks. A slot beyond trackgate of every
+// prediction is a new contact.
+//
+uint32_t TrackContacts(csgesture_softc *sc, uint32_t slots) {
+	int x[MAX_FINGERS], y[MAX_FINGERS], p[MAX_FINGERS];
+	int major[MAX_FINGERS], minor[MAX_FINGERS];
+	int64_t cost[MAX_FINGERS][MAX_FINGERS];
+	int idforslot[MAX_FINGERS];
+
+	uint32_t tracked = sc->trackedmask;
+
+	for (uint32_t m = slots; m; m &= m - 1) {
+		int s = firstcontact(m);
+		x[s] = sc->x[s];
+		y[s] = sc->y[s];
+		p[s] = sc->p[s];
+		major[s] = sc->major[s];
+		minor[s] = sc->minor[s];
+
+		for (uint32_t n = tracked; n; n &= n - 1) {
+			int t = firstcontact(n);
+			cost[s][t] = distancesq(x[s] - (sc->trackx[t] + sc->trackvx[t]), y[s] - (sc->tracky[t] + sc->trackvy[t]));
+		}
+	}
+
+	uint32_t freeslots = slots;
+	uint32_t freeids = tracked;
+	uint32_t ids = 0;
+
+	while (freeslots && freeids) {
+		int bests = -1;
+		int bestt = -1;
+		for (uint32_t m = freeslots; m; m &= m - 1) {
+			int s = firstcontact(m);
+			for (uint32_t n = freeids; n; n &= n - 1) {
+				int t = firstcontact(n);
+				if (bests == -1 || cost[s][t] < cost[bests][bestt]) {
+					bests = s;
+					bestt = t;
+				}
+			}
+		}
+		if (cost[bests][bestt] > sc->thresholds.trackgatesq)
+			break;
+
+		idforslot[bests] = bestt;
+		freeslots &= ~contactbit(bests);
+		freeids &= ~contactbit(bestt);
+		ids |= contactbit(bestt);
+
+		sc->trackvx[bestt] = x[bests] - sc->trackx[bestt];
+		sc->trackvy[bestt] = y[bests] - sc->tracky[bestt];
+		sc->trackx[bestt] = x[bests];
+		sc->tracky[bestt] = y[bests];
+	}
+
+	//
+	// New contacts take an id that was not down last frame, so they read as
+	// landings with fresh history. With every id taken (one finger lifting as
+	// another lands), the new contact is dropped for this frame and gets the
+	// freed id on the next.
+	//
+	for (uint32_t m = freeslots; m; m &= m - 1) {
+		int s = firstcontact(m);
+		uint32_t candidates = FINGER_SLOTS(MAX_FINGERS) & ~tracked & ~ids;
+		if (candidates == 0) {
+			slots &= ~contactbit(s);
+			continue;
+		}
+		int t = firstcontact(candidates);
+
+		idforslot[s] = t;
+		ids |= contactbit(t);
+
+		sc->trackvx[t] = 0;
+		sc->trackvy[t] = 0;
+		sc->trackx[t] = x[s];
+		sc->tracky[t] = y[s];
+		sc->filterx[t].primed = false;
+		sc->filtery[t].primed = false;
+		window_reset(&sc->motionx[t]);
+		window_reset(&sc->motiony[t]);
+	}
+
+	for (int i = 0; i < MAX_FINGERS; i++) {
+		sc->x[i] = -1;
+		sc->y[i] = -1;
+		sc->p[i] = -1;
+		sc->major[i] = 0;
+		sc->minor[i] = 0;
+	}
+	for (uint32_t m = slots; m; m &= m - 1) {
+		int s = firstcontact(m);
+		int t = idforslot[s];
+		sc->x[t] = x[s];
+		sc->y[t] = y[s];
+		sc->p[t] = p[s];
+		sc->major[t] = major[s];
+		sc->minor[t] = minor[s];
+	}
+
+	sc->trackedmask = ids;
+	return ids;
 }
 
 void TrackpadRawInput(PDEVICE_CONTEXT pDevice, struct csgesture_softc *sc, uint8_t report[ETP_MAX_REPORT_LEN], int tickinc) {
@@ -1172,6 +1999,10 @@ void TrackpadRawInput(PDEVICE_CONTEXT pDevice, struct csgesture_softc *sc, uint8
 		return;
 	}
 
+	//contacts are stamped with the time the ISR read the frame, timeouts run on the current time
+	sc->frametime = (uint32_t)(pDevice->LastInterruptTime / 10000);
+	sc->now = (uint32_t)(KeQueryInterruptTime() / 10000);
+
 	uint8_t *finger_data = &report[ETP_FINGER_DATA_OFFSET];
 	int i;
 	uint8_t tp_info = report[ETP_TOUCH_INFO_OFFSET];
@@ -1179,11 +2010,14 @@ void TrackpadRawInput(PDEVICE_CONTEXT pDevice, struct csgesture_softc *sc, uint8
 	bool contact_valid, hover_event;
 
 	int nfingers = 0;
+	uint32_t contacts = 0;
 
-	for (int i = 0;i < 5; i++) {
+	for (int i = 0;i < MAX_FINGERS; i++) {
 		sc->x[i] = -1;
 		sc->y[i] = -1;
 		sc->p[i] = -1;
+		sc->major[i] = 0;
+		sc->minor[i] = 0;
 	}
 
 	hover_event = hover_info & 0x40;
@@ -1204,26 +2038,14 @@ void TrackpadRawInput(PDEVICE_CONTEXT pDevice, struct csgesture_softc *sc, uint8
 			mk_y = (finger_data[3] >> 4);
 			pressure = finger_data[4];
 
-			//map to cypress coordinates
-			//pos_y = 1500 - pos_y;
 			pos_y = pDevice->max_y - pos_y;
-			/*pos_x *= 2;
-			pos_x /= 7;
-			pos_y *= 2;
-			pos_y /= 7;*/
-			pos_x *= 10;
-			pos_x /= pDevice->hw_res_x;
-
-			pos_y *= 10;
-			pos_y /= pDevice->hw_res_y;
 
 
 			/*
-			* To avoid treating large finger as palm, let's reduce the
-			* width x and y per trace.
+			* mk_x and mk_y count the traces covered by the contact.
 			*/
-			area_x = mk_x;
-			area_y = mk_y;
+			area_x = mk_x * sc->tracewidthx;
+			area_y = mk_y * sc->tracewidthy;
 
 			major = max(area_x, area_y);
 			minor = min(area_x, area_y);
@@ -1232,9 +2054,11 @@ void TrackpadRawInput(PDEVICE_CONTEXT pDevice, struct csgesture_softc *sc, uint8
 
 			if (scaled_pressure > ETP_MAX_PRESSURE)
 				scaled_pressure = ETP_MAX_PRESSURE;
-			sc->x[i] = pos_x;
-			sc->y[i] = pos_y;
+			sc->x[i] = pos_x << CSGESTURE_FP_SHIFT;
+			sc->y[i] = pos_y << CSGESTURE_FP_SHIFT;
 			sc->p[i] = scaled_pressure;
+			sc->major[i] = major;
+			sc->minor[i] = minor;
 		}
 		else {
 		}
@@ -1242,13 +2066,105 @@ void TrackpadRawInput(PDEVICE_CONTEXT pDevice, struct csgesture_softc *sc, uint8
 		if (contact_valid) {
 			finger_data += ETP_FINGER_DATA_LEN;
 			nfingers++;
+			contacts |= 1U << i;
 		}
 	}
 	sc->buttondown = (tp_info & 0x01);
 
+	UpdateContactMasks(sc, RejectPalms(sc, TrackContacts(sc, contacts)));
+	RejectOutliers(sc);
+	FilterContacts(sc);
+
 	ProcessGesture(pDevice, sc);
 }
 
+//
+// Tuning profiles. Row 0 is the default for pads without a row of their own;
+// the rows after it are sorted by product id, then by firmware range, with no
+// overlapping ranges for one product. Add a row once a model has been
+// characterised and needs different thresholds, filter constants or quirks.
+//
+static const csgesture_profile GestureProfiles[] = {
+	{
+		CSGESTURE_PROFILE_ANY,	//prodid
+		0,						//fwmin
+		0xff,					//fwmax
+
+		4000,					//outlier
+		500,					//scrollstart
+		1500,					//swipestart
+		5000,					//swipecommit
+		500,					//swipevelocity
+		6000,					//bottomzone
+		141,					//motion
+		25000,					//palmmajor
+		14000,					//thumbmajor
+		15000,					//thumbzone
+		10000,					//restmajor
+		4000,					//wheeldetent
+		2000,					//pinchstart
+		1500,					//taptravel
+		12000,					//trackgate
+
+		1000,					//filterMinCutoff
+		200,					//filterBeta
+
+		0						//quirks
+	},
+};
+
+static bool GestureProfilesSorted() {
+	for (size_t i = 1; i < ARRAYSIZE(GestureProfiles); i++) {
+		const csgesture_profile *profile = &GestureProfiles[i];
+		if (profile->fwmin > profile->fwmax)
+			return false;
+		if (i == 1)
+			continue;
+		const csgesture_profile *prev = &GestureProfiles[i - 1];
+		if (prev->prodid > profile->prodid || (prev->prodid == profile->prodid && prev->fwmax >= profile->fwmin))
+			return false;
+	}
+	return true;
+}
+
+static const csgesture_profile *FindGestureProfile(int prodid, int fwversion) {
+	int lo = 1;
+	int hi = ARRAYSIZE(GestureProfiles) - 1;
+	while (lo <= hi) {
+		int mid = (lo + hi) / 2;
+		const csgesture_profile *profile = &GestureProfiles[mid];
+		if (profile->prodid < prodid || (profile->prodid == prodid && profile->fwmax < fwversion))
+			lo = mid + 1;
+		else if (profile->prodid > prodid || profile->fwmin > fwversion)
+			hi = mid - 1;
+		else
+			return profile;
+	}
+	return &GestureProfiles[0];
+}
+
+void SetGestureProfile(struct csgesture_softc *sc, int prodid, int fwversion) {
+	NT_ASSERT(GestureProfilesSorted());
+
+	//filter constants are defaults; a reboot of the pad must not undo user settings
+	bool first = sc->profile == NULL;
+
+	sc->profile = FindGestureProfile(prodid, fwversion);
+	sc->quirks = sc->profile->quirks;
+	if (first) {
+		sc->settings.filterMinCutoff = sc->profile->filterMinCutoff;
+		sc->settings.filterBeta = sc->profile->filterBeta;
+		sc->settings.softButtonHeight = sc->profile->bottomzone;
+	}
+}
+
+//rebuilds everything derived from the settings
+static void ApplySettings(struct csgesture_softc *sc) {
+	SetSwipeActions(sc);
+	SetPointerCurve(sc);
+	SetSoftButtons(sc);
+}
+
 void SetDefaultSettings(struct csgesture_softc *sc) {
 	sc->settings.pointerMultiplier = 10; //done
 
@@ -1257,6 +2173,8 @@ void SetDefaultSettings(struct csgesture_softc *sc) {
 	sc->settings.clickWithNoFingers = true;
 	sc->settings.multiFingerClick = true;
 	sc->settings.rightClickBottomRight = false;
+	sc->settings.softButtonHeight = GestureProfiles[0].bottomzone;
+	sc->settings.softButtonMiddleWidth = 0;
 
 	//tap settings
 	sc->settings.tapToClickEnabled = true;
@@ -1267,6 +2185,10 @@ void SetDefaultSettings(struct csgesture_softc *sc) {
 
 	sc->settings.fourFingerTapEnabled = true;
 
+	sc->settings.tapWindow = 180;
+	sc->settings.multiTapWindow = 250;
+	sc->settings.tapDragWindow = 180;
+
 	//scroll settings
 	sc->settings.scrollEnabled = true;
 
@@ -1279,6 +2201,80 @@ void SetDefaultSettings(struct csgesture_softc *sc) {
 	sc->settings.fourFingerSwipeUpGesture = SwipeUpGestureTaskView;
 	sc->settings.fourFingerSwipeDownGesture = SwipeDownGestureShowDesktop;
 	sc->settings.fourFingerSwipeLeftRightGesture = SwipeGestureSwitchWorkspace;
+
+	//motion history
+	sc->settings.motionWindow = 10;
+
+	//pointer smoothing
+	sc->settings.filterMinCutoff = GestureProfiles[0].filterMinCutoff;
+	sc->settings.filterBeta = GestureProfiles[0].filterBeta;
+
+	//pointer prediction
+	sc->settings.predictHorizon = 0;
+
+	//pointer acceleration
+	sc->settings.accelThreshold = 5;
+	sc->settings.accelRate = 5;
+	sc->settings.accelMax = 200;
+
+	//momentum scrolling
+	sc->settings.scrollFriction = 950;
+
+	//pinch to zoom
+	sc->settings.pinchEnabled = true;
+
+	//whole detents until the host enables the wheel resolution multiplier
+	sc->wheelresx = 1;
+	sc->wheelresy = 1;
+
+	ApplySettings(sc);
+}
+
+void SetGestureThresholds(struct csgesture_softc *sc) {
+	struct csgesture_thresholds *t = &sc->thresholds;
+	const csgesture_profile *p = sc->profile ? sc->profile : &GestureProfiles[0];
+
+	t->outlierx = um_to_units(p->outlier, sc->unitspermmx);
+	t->outliery = um_to_units(p->outlier, sc->unitspermmy);
+
+	t->scrollstartx = um_to_units(p->scrollstart, sc->unitspermmx);
+	t->scrollstarty = um_to_units(p->scrollstart, sc->unitspermmy);
+
+	t->swipestartx = um_to_units(p->swipestart, sc->unitspermmx);
+	t->swipestarty = um_to_units(p->swipestart, sc->unitspermmy);
+	t->swipecommitx = um_to_units(p->swipecommit, sc->unitspermmx);
+	t->swipecommity = um_to_units(p->swipecommit, sc->unitspermmy);
+	t->swipevelocityx = um_to_units(p->swipevelocity, sc->unitspermmx);
+	t->swipevelocityy = um_to_units(p->swipevelocity, sc->unitspermmy);
+
+	int motion = um_to_units(p->motion, (sc->unitspermmx + sc->unitspermmy) / 2);
+	t->motionsq = (int64_t)motion * motion;
+
+	int taptravel = um_to_units(p->taptravel, (sc->unitspermmx + sc->unitspermmy) / 2);
+	t->taptravelsq = (int64_t)taptravel * taptravel;
+
+	int trackgate = um_to_units(p->trackgate, (sc->unitspermmx + sc->unitspermmy) / 2);
+	t->trackgatesq = (int64_t)trackgate * trackgate;
+
+	t->palmmajor = um_to_units(p->palmmajor, sc->unitspermmx);
+	t->thumbmajor = um_to_units(p->thumbmajor, sc->unitspermmx);
+	t->thumbzone = um_to_units(p->thumbzone, sc->unitspermmy);
+	t->restmajor = um_to_units(p->restmajor, sc->unitspermmx);
+
+	t->wheeldetentx = max(um_to_units(p->wheeldetent, sc->unitspermmx), 1);
+	t->wheeldetenty = max(um_to_units(p->wheeldetent, sc->unitspermmy), 1);
+	t->momentumstopx = t->wheeldetentx * GESTURE_TICK_MS / 1000;
+	t->momentumstopy = t->wheeldetenty * GESTURE_TICK_MS / 1000;
+
+	int unitspermm = (sc->unitspermmx + sc->unitspermmy) / 2;
+	t->pinchstart = um_to_units(p->pinchstart, unitspermm);
+	t->pinchdetent = max(um_to_units(p->wheeldetent, unitspermm), 1);
+
+	t->speedx = (int)(((int64_t)(1000 / GESTURE_TICK_MS) << CSGESTURE_RECIP_SHIFT) / sc->unitspermmx);
+	t->speedy = (int)(((int64_t)(1000 / GESTURE_TICK_MS) << CSGESTURE_RECIP_SHIFT) / sc->unitspermmy);
+
+	SetPointerCurve(sc);
+	SetSoftButtons(sc);
 }
 
 void ProcessInfo(PDEVICE_CONTEXT pDevice, struct csgesture_softc *sc, int infoValue) {
@@ -1296,6 +2292,28 @@ void ProcessInfo(PDEVICE_CONTEXT pDevice, struct csgesture_softc *sc, int infoVa
 	case 2: //firmware version
 		strcpy((char *)report.Value, sc->firmware_version);
 		break;
+	case 3: //frame validation counters
+		RtlStringCbPrintfA((char *)report.Value, sizeof(report.Value), "ok %lu io %lu empty %lu len %lu id %lu contact %lu",
+			pDevice->FramesAccepted,
+			pDevice->FramesDropped[ETP_DROP_IO],
+			pDevice->FramesDropped[ETP_DROP_EMPTY],
+			pDevice->FramesDropped[ETP_DROP_LENGTH],
+			pDevice->FramesDropped[ETP_DROP_REPORT_ID],
+			pDevice->FramesDropped[ETP_DROP_CONTACT]);
+		break;
+	case 4: //gesture engine build and average cycles per frame
+		RtlStringCbPrintfA((char *)report.Value, sizeof(report.Value), "fingers %d features %04x cycles %llu",
+			CSGESTURE_ENGINE_FINGERS,
+			CSGESTURE_ENGINE_FEATURES,
+			pDevice->GestureFrames ? pDevice->GestureCycles / pDevice->GestureFrames : 0);
+		break;
+	case 5: //reports sent and suppressed per output stream
+		RtlStringCbPrintfA((char *)report.Value, sizeof(report.Value), "mouse %lu/%lu kbd %lu/%lu",
+			pDevice->ReportsSent[ELAN_OUTPUT_MOUSE],
+			pDevice->ReportsSuppressed[ELAN_OUTPUT_MOUSE],
+			pDevice->ReportsSent[ELAN_OUTPUT_KEYBOARD],
+			pDevice->ReportsSuppressed[ELAN_OUTPUT_KEYBOARD]);
+		break;
 	}
 
 	size_t bytesWritten;
@@ -1305,6 +2323,8 @@ void ProcessInfo(PDEVICE_CONTEXT pDevice, struct csgesture_softc *sc, int infoVa
 void ProcessSetting(PDEVICE_CONTEXT pDevice, struct csgesture_softc *sc, int settingRegister, int settingValue) {
 	switch (settingRegister) {
 	case 0:
+		if (settingValue < 0 || settingValue > ACCEL_MAX_MULTIPLIER)
+			break;
 		sc->settings.pointerMultiplier = settingValue;
 		break;
 	case 1:
@@ -1355,8 +2375,90 @@ void ProcessSetting(PDEVICE_CONTEXT pDevice, struct csgesture_softc *sc, int set
 	case 16:
 		sc->settings.fourFingerSwipeLeftRightGesture = (SwipeGesture)settingValue;
 		break;
+	case 17:
+		if (settingValue < 1 || settingValue > MAX_MOTION_WINDOW)
+			break;
+		sc->settings.motionWindow = settingValue;
+		for (int i = 0; i < MAX_FINGERS; i++) {
+			window_reset(&sc->motionx[i]);
+			window_reset(&sc->motiony[i]);
+		}
+		break;
+	case 18:
+		if (settingValue < 0 || settingValue > FILTER_MAX_CUTOFF)
+			break;
+		sc->settings.filterMinCutoff = settingValue;
+		for (int i = 0; i < MAX_FINGERS; i++) {
+			sc->filterx[i].primed = false;
+			sc->filtery[i].primed = false;
+		}
+		break;
+	case 19:
+		if (settingValue < 0 || settingValue > FILTER_MAX_BETA)
+			break;
+		sc->settings.filterBeta = settingValue;
+		break;
+	case 20:
+		if (settingValue < 0 || settingValue > 50)
+			break;
+		sc->settings.predictHorizon = settingValue;
+		ResetPrediction(sc, -1);
+		break;
+	case 21:
+		if (settingValue < 0 || settingValue >= ACCEL_STEPS)
+			break;
+		sc->settings.accelThreshold = settingValue;
+		break;
+	case 22:
+		if (settingValue < 0 || settingValue > sc->settings.accelMax)
+			break;
+		sc->settings.accelRate = settingValue;
+		break;
+	case 23:
+		if (settingValue < 100 || settingValue > 1000)
+			break;
+		sc->settings.accelMax = settingValue;
+		break;
+	case 24:
+		if (settingValue < 0 || settingValue >= 1000)
+			break;
+		sc->settings.scrollFriction = settingValue;
+		if (settingValue == 0)
+			StopMomentum(sc);
+		break;
+	case 25:
+		sc->settings.pinchEnabled = settingValue;
+		if (!settingValue && sc->pinchActive)
+			EndPinch(pDevice, sc);
+		break;
+	case 26:
+		if (settingValue < 0)
+			break;
+		sc->settings.tapWindow = settingValue;
+		break;
+	case 27:
+		if (settingValue < 0)
+			break;
+		sc->settings.multiTapWindow = settingValue;
+		break;
+	case 28:
+		if (settingValue < 0)
+			break;
+		sc->settings.tapDragWindow = settingValue;
+		break;
+	case 29:
+		if (settingValue < 0)
+			break;
+		sc->settings.softButtonHeight = settingValue;
+		break;
+	case 30:
+		if (settingValue < 0)
+			break;
+		sc->settings.softButtonMiddleWidth = settingValue;
+		break;
 	case 255: //255 is for driver info
 		ProcessInfo(pDevice, sc, settingValue);
-		break;
+		return;
 	}
+	ApplySettings(sc);
 }
\ No newline at end of file
@@ -61,6 +61,20 @@
 #define ETP_HOVER_INFO_OFFSET	30
 #define ETP_MAX_REPORT_LEN	34
 
+/* Report IDs routed through the report dispatch table */
+#define ETP_REPORT_ID_BASE	ETP_REPORT_ID
+#define ETP_REPORT_ID_COUNT	4
+
+/* Reasons an incoming frame is dropped before reaching the gesture engine */
+enum etp_frame_drop {
+	ETP_DROP_IO = 0,	/* SPB read failed */
+	ETP_DROP_EMPTY,		/* no data pending (0xff fill) */
+	ETP_DROP_LENGTH,	/* length prefix does not match ETP_I2C_REPORT_LEN */
+	ETP_DROP_REPORT_ID,	/* report id has no handler */
+	ETP_DROP_CONTACT,	/* contact bit set but finger data out of range */
+	ETP_DROP_MAX
+};
+
 enum tp_mode {
 	IAP_MODE = 1,
 	MAIN_MODE
@@ -1,5 +1,46 @@
 #include "stdint.h"
 
+#define MAX_FINGERS 5
+#define MAX_MOTION_WINDOW 16
+#define ACCEL_STEPS 64 //pointer speeds, 0.1 mm per tick each
+#define SOFTBUTTON_COLUMNS 64
+
+//coordinates are carried in native sensor units with CSGESTURE_FP_SHIFT fractional bits
+#define CSGESTURE_FP_SHIFT 8
+#define CSGESTURE_FP_ONE (1 << CSGESTURE_FP_SHIFT)
+
+//per-frame conversions out of sensor units multiply by reciprocals with this many fractional bits
+#define CSGESTURE_RECIP_SHIFT 24
+
+//
+// Engine features. The gesture engine is a template over the finger count and
+// a feature mask; features left out of the mask compile away. With
+// CSGESTURE_FEATURE_RUNTIME set each compiled-in feature is still gated by its
+// setting, otherwise the setting is ignored and the feature is always on.
+// Define CSGESTURE_ENGINE_FINGERS / CSGESTURE_ENGINE_FEATURES in the project
+// to build a fixed configuration.
+//
+#define CSGESTURE_FEATURE_TAP			0x0001 //tapToClickEnabled
+#define CSGESTURE_FEATURE_TAPDRAG		0x0002 //tapDragEnabled
+#define CSGESTURE_FEATURE_MULTITAP		0x0004 //multiFingerTap
+#define CSGESTURE_FEATURE_FOURTAP		0x0008 //fourFingerTapEnabled
+#define CSGESTURE_FEATURE_SCROLL		0x0010 //scrollEnabled
+#define CSGESTURE_FEATURE_SWIPE			0x0020
+#define CSGESTURE_FEATURE_MULTICLICK	0x0040 //multiFingerClick
+#define CSGESTURE_FEATURE_BOTTOMRIGHT	0x0080 //rightClickBottomRight, soft buttons
+#define CSGESTURE_FEATURE_PINCH			0x0100 //pinchEnabled
+#define CSGESTURE_FEATURE_RUNTIME		0x8000
+
+#define CSGESTURE_FEATURES_ALL			0x01ff
+
+#ifndef CSGESTURE_ENGINE_FINGERS
+#define CSGESTURE_ENGINE_FINGERS MAX_FINGERS
+#endif
+
+#ifndef CSGESTURE_ENGINE_FEATURES
+#define CSGESTURE_ENGINE_FEATURES (CSGESTURE_FEATURES_ALL | CSGESTURE_FEATURE_RUNTIME)
+#endif
+
 typedef enum {
 	ThreeFingerTapActionCortana,
 	ThreeFingerTapActionWheelClick,
@@ -16,12 +57,42 @@ typedef enum {
 	SwipeDownGestureNone
 } SwipeDownGesture;
 
+typedef enum {
+	PressureClassNone,
+	PressureClassBrush,
+	PressureClassTap,
+	PressureClassHard
+} PressureClass;
+
 typedef enum {
 	SwipeGestureAltTabSwitcher,
 	SwipeGestureSwitchWorkspace,
 	SwipeGestureNone
 } SwipeGesture;
 
+typedef enum {
+	SwipeStateIdle,
+	SwipeStateSwitcher, //alt-tab switcher showing, alt held
+	SwipeStateCount
+} SwipeState;
+
+typedef enum {
+	SwipeEventUp,
+	SwipeEventDown,
+	SwipeEventLeft,
+	SwipeEventRight,
+	SwipeEventCount
+} SwipeEvent;
+
+//key chord fired by a swipe, resolved from the settings
+struct csgesture_swipe_action {
+	uint8_t shiftKeys;
+	uint8_t keyCode; //0 when the swipe does nothing
+	uint8_t holdKeys; //modifiers left down after the chord
+	bool commit; //requires the commit distance rather than the start distance
+	SwipeState nextState;
+};
+
 struct csgesture_settings {
 	int pointerMultiplier; //done
 
@@ -29,7 +100,9 @@ struct csgesture_settings {
 	bool swapLeftRightFingers; //done
 	bool clickWithNoFingers; //done
 	bool multiFingerClick; //done
-	bool rightClickBottomRight;
+	bool rightClickBottomRight; //soft buttons along the bottom edge
+	int softButtonHeight; //um
+	int softButtonMiddleWidth; //um, 0 for left and right only
 
 	//tap settings
 	bool tapToClickEnabled; //done
@@ -40,6 +113,10 @@ struct csgesture_settings {
 
 	bool fourFingerTapEnabled; //done
 
+	int tapWindow; //ms from landing to lift for a one finger tap
+	int multiTapWindow; //ms for taps with more fingers
+	int tapDragWindow; //ms a tap waits for the next touch to drag
+
 							   //scroll settings
 	int scrollEnabled; //done
 
@@ -52,18 +129,147 @@ struct csgesture_settings {
 	SwipeUpGesture fourFingerSwipeUpGesture;
 	SwipeDownGesture fourFingerSwipeDownGesture;
 	SwipeGesture fourFingerSwipeLeftRightGesture;
+
+	//motion history
+	int motionWindow;
+
+	//pointer smoothing, 0 min cutoff disables
+	int filterMinCutoff; //mHz
+	int filterBeta; //mHz of cutoff per mm/s
+
+	//pointer prediction, 0 disables
+	int predictHorizon; //ms
+
+	//pointer acceleration, gain in percent of pointerMultiplier
+	int accelThreshold; //0.1 mm per tick where gain starts to rise
+	int accelRate; //percent per 0.1 mm per tick above the threshold
+	int accelMax; //percent
+
+	//momentum scrolling, 0 disables
+	int scrollFriction; //per mille of speed kept each tick
+
+	//two finger pinch sends ctrl + wheel
+	bool pinchEnabled;
+};
+
+//
+// Per-model tuning, chosen once at bring-up by product id and firmware.
+// Distances are in micrometres.
+//
+#define CSGESTURE_PROFILE_ANY -1 //default row, matches every product id
+
+#define CSGESTURE_QUIRK_NO_CONTACT_SIZE	0x1 //trace counts unusable, no size-based palm rejection
+#define CSGESTURE_QUIRK_NO_PRESSURE		0x2 //pressure unusable, every landing counts as a tap
+
+struct csgesture_profile {
+	int prodid;
+	int fwmin;
+	int fwmax;
+
+	int outlier; //per tick beyond the contact's speed
+	int scrollstart;
+	int swipestart;
+	int swipecommit;
+	int swipevelocity; //per tick
+	int bottomzone; //default soft button height
+	int motion; //averaged per tick
+	int palmmajor;
+	int thumbmajor;
+	int thumbzone;
+	int restmajor; //wider contacts at rest are thumbs
+	int wheeldetent; //scroll distance per wheel detent
+	int pinchstart; //change in finger spread
+	int taptravel; //from the landing point
+	int trackgate; //per tick from the predicted position
+
+	int filterMinCutoff; //mHz
+	int filterBeta;
+
+	uint32_t quirks;
+};
+
+//sliding window of per-tick motion samples with a running sum
+struct csgesture_window {
+	int samples[MAX_MOTION_WINDOW];
+	int head;
+	int count;
+	int sum;
+};
+
+//speed-adaptive low pass state for one axis of one contact
+struct csgesture_filter {
+	int value;
+	int velocity; //per tick
+	bool primed;
+};
+
+//distance thresholds resolved into fixed point sensor units at bring-up
+struct csgesture_thresholds {
+	int outlierx; //per tick step error tolerated on top of the contact's speed
+	int outliery;
+
+	int scrollstartx;
+	int scrollstarty;
+
+	int swipestartx;
+	int swipestarty;
+	int swipecommitx;
+	int swipecommity;
+	int swipevelocityx; //per tick
+	int swipevelocityy;
+
+	int64_t motionsq;
+	int64_t taptravelsq;
+	int64_t trackgatesq;
+
+	int palmmajor;
+	int thumbmajor;
+	int thumbzone;
+	int restmajor;
+
+	int wheeldetentx;
+	int wheeldetenty;
+	int momentumstopx; //per tick
+	int momentumstopy;
+
+	int pinchstart;
+	int pinchdetent;
+
+	//reciprocals of the resolution
+	int speedx; //mm/s per unit per tick
+	int speedy;
 };
 
 struct csgesture_softc {
 	struct csgesture_settings settings;
+	const struct csgesture_profile *profile;
+	uint32_t quirks;
+	struct csgesture_thresholds thresholds;
+
+	//contact tracking, by persistent id
+	uint32_t trackedmask;
+	int trackx[MAX_FINGERS];
+	int tracky[MAX_FINGERS];
+	int trackvx[MAX_FINGERS]; //per tick
+	int trackvy[MAX_FINGERS];
+
+	//hardware input, indexed by contact id
+	uint32_t activemask; //contacts present this frame
+	uint32_t newmask; //contacts that landed this frame
+	uint32_t liftedmask; //contacts that lifted this frame
 
-	//hardware input
-	int x[15];
-	int y[15];
-	int p[15];
+	int x[MAX_FINGERS];
+	int y[MAX_FINGERS];
+	int p[MAX_FINGERS];
+
+	int major[MAX_FINGERS];
+	int minor[MAX_FINGERS];
 
 	bool buttondown;
 
+	uint32_t frametime; //ms, when the frame was read
+	uint32_t now; //ms, when the frame is processed
+
 	//hardware info
 	bool infoSetup;
 
@@ -75,6 +281,12 @@ struct csgesture_softc {
 	int phyx;
 	int phyy;
 
+	int unitspermmx; //sensor units per mm, fixed point
+	int unitspermmy;
+
+	int tracewidthx; //sensor units per trace, fixed point
+	int tracewidthy;
+
 	//system output
 	int dx;
 	int dy;
@@ -88,44 +300,104 @@ struct csgesture_softc {
 	int panningActive;
 	int idForPanning;
 
+	//pointer prediction for the panning contact
+	int predictid;
+	int predictvx; //last velocity, per tick
+	int predictvy;
+	int predictleadx; //lead already applied to the pointer
+	int predictleady;
+
+	//pointer curve, Q24 counts per unit for each speed step
+	int accelx[ACCEL_STEPS];
+	int accely[ACCEL_STEPS];
+	int accelscale; //speed steps per unit, reciprocal
+	int accelremx; //Q24 counts not yet sent
+	int accelremy;
+
 	int scrollingActive;
 	int idsForScrolling[2];
 	int ticksSinceScrolling;
 
-	int scrollInertiaActive;
-
-	int blacklistedids[15];
+	//wheel counts per detent, WHEEL_RESOLUTION once the host enables the multiplier
+	int wheelresx;
+	int wheelresy;
+
+	//momentum scrolling
+	int scrollvx; //release velocity, per tick
+	int scrollvy;
+	bool momentumActive;
+	int momentumvx;
+	int momentumvy;
+	int wheelremx; //scroll distance not yet sent as detents
+	int wheelremy;
+	uint32_t momentumstopmask; //contacts that stopped momentum, not taps
+
+	//pinch to zoom
+	bool pinchActive;
+	int idsForPinch[2];
+	int pinchspread; //spread change not yet sent
+	int pinchtravel; //translation while undecided
+	int pinchrem; //spread not yet sent as wheel counts
+	bool pinchrelease; //ctrl release not yet delivered
+
+	//soft button regions along the bottom edge
+	uint8_t softbuttons[SOFTBUTTON_COLUMNS];
+	int softbuttonscale; //columns per unit, reciprocal
+	int softbuttontop;
+
+	uint32_t rejectedmask;
+	uint32_t restingmask; //parked on the click area, not part of any gesture
 
 	bool mouseDownDueToTap;
 	int idForMouseDown;
 	bool mousedown;
 	int mousebutton;
 
-	int lastx[15];
-	int lasty[15];
-	int lastp[15];
+	int lastx[MAX_FINGERS];
+	int lasty[MAX_FINGERS];
+	int lastp[MAX_FINGERS];
+
+	struct csgesture_window motionx[MAX_FINGERS];
+	struct csgesture_window motiony[MAX_FINGERS];
 
-	int xhistory[15][10];
-	int yhistory[15][10];
+	//unfiltered motion for outlier rejection
+	int rawx[MAX_FINGERS];
+	int rawy[MAX_FINGERS];
+	int rawvx[MAX_FINGERS];
+	int rawvy[MAX_FINGERS];
+	int outliers[MAX_FINGERS]; //consecutive rejected steps
 
-	int flextotalx[15];
-	int flextotaly[15];
+	struct csgesture_filter filterx[MAX_FINGERS];
+	struct csgesture_filter filtery[MAX_FINGERS];
 
-	int totalx[15];
-	int totaly[15];
-	int totalp[15];
+	int pressurepeak[MAX_FINGERS];
+	int pressureonset[MAX_FINGERS]; //steepest rise per tick while landing
+	int pressuresteady[MAX_FINGERS]; //running average, 4 fractional bits
+	PressureClass pressureclass[MAX_FINGERS];
 
 	int multitaskingx;
 	int multitaskingy;
 	int multitaskinggesturetick;
 	bool multitaskingdone;
+	SwipeEvent swipecoherentevent;
+	int swipecoherentticks; //consecutive ticks all swiping contacts agreed
 
-	bool alttabswitchershowing;
+	SwipeState swipestate;
+	struct csgesture_swipe_action swipeactions[SwipeStateCount][2][SwipeEventCount];
 
 	int idsforalttab[3];
 
-	int tick[15];
-	int truetick[15];
-	int ticksincelastrelease;
-	int tickssinceclick;
+	//tap detection
+	uint32_t downtime[MAX_FINGERS];
+	int downx[MAX_FINGERS];
+	int downy[MAX_FINGERS];
+	bool tapgroup; //contacts down since the pad was last empty
+	bool tapvalid; //none of them moved, scrolled, swiped or clicked
+	int tapfingers; //of them lifted so far
+	uint32_t tapstart;
+	uint32_t taptime; //when the held tap button went down
+	int tapclick; //button of a tap click not yet delivered
+
+	int tick[MAX_FINGERS];
+	int truetick[MAX_FINGERS];
 };
\ No newline at end of file
@@ -17,10 +17,9 @@
 #define REPORTID_FEATURE        0x02
 #define REPORTID_RELATIVE_MOUSE 0x04
 #define REPORTID_TOUCHPAD       0x05
-#define REPORTID_SCROLL			0x06
 #define REPORTID_KEYBOARD       0x07
-#define REPORTID_SCROLLCTRL		0x08
 #define REPORTID_SETTINGS		0x09
+#define REPORTID_WHEELRES		0x0A
 
 //
 // Keyboard specific report infomation
@@ -68,8 +67,8 @@ typedef struct _ELAN_KEYBOARD_REPORT
 // Relative mouse specific report information
 //
 
-#define RELATIVE_MOUSE_MIN_COORDINATE   -127
-#define RELATIVE_MOUSE_MAX_COORDINATE   127
+#define RELATIVE_MOUSE_MIN_COORDINATE   -32767
+#define RELATIVE_MOUSE_MAX_COORDINATE   32767
 
 #pragma pack(1)
 typedef struct _ELAN_RELATIVE_MOUSE_REPORT
@@ -79,9 +78,9 @@ typedef struct _ELAN_RELATIVE_MOUSE_REPORT
 
 	BYTE        Button;
 
-	BYTE        XValue;
+	SHORT       XValue;
 
-	BYTE        YValue;
+	SHORT       YValue;
 
 	BYTE        WheelPosition;
 
@@ -91,36 +90,25 @@ typedef struct _ELAN_RELATIVE_MOUSE_REPORT
 #pragma pack()
 
 //
-// Scroll specific report information
+// Wheel resolution multiplier feature report. Until the host enables a
+// multiplier each wheel count is a whole detent; once enabled a detent is
+// WHEEL_RESOLUTION counts.
 //
-#pragma pack(1)
-typedef struct _ELAN_SCROLL_REPORT
-{
-
-	BYTE        ReportID;
-
-	BYTE		Flag;
 
-	USHORT        Touch1XValue;
+#define WHEEL_RESOLUTION        120
 
-	USHORT        Touch1YValue;
-
-	USHORT        Touch2XValue;
-
-	USHORT        Touch2YValue;
-
-} ElanScrollReport;
-#pragma pack()
+#define WHEELRES_VERTICAL_MASK    0x03
+#define WHEELRES_HORIZONTAL_MASK  0x0C
 
 #pragma pack(1)
-typedef struct _ELAN_SCROLL_CONTROL_REPORT
+typedef struct _ELAN_WHEEL_RESOLUTION_REPORT
 {
 
 	BYTE        ReportID;
 
-	BYTE		Flag;
+	BYTE        Multipliers;
 
-} ElanScrollControlReport;
+} ElanWheelResolutionReport;
 #pragma pack()
 
 #pragma pack(1)
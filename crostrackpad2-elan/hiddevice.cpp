@@ -409,7 +409,6 @@ ElanWriteReport(
 	NTSTATUS status = STATUS_SUCCESS;
 	WDF_REQUEST_PARAMETERS params;
 	PHID_XFER_PACKET transferPacket = NULL;
-	ElanScrollControlReport *pScrollCtrlReport = NULL;
 	ElanSettingsReport *pSettingsReport = NULL;
 	size_t bytesWritten = 0;
 
@@ -446,19 +445,6 @@ ElanWriteReport(
 
 			switch (transferPacket->reportId)
 			{
-			case REPORTID_SCROLLCTRL:
-
-				pScrollCtrlReport = (ElanScrollControlReport *)transferPacket->reportBuffer;
-
-				if (pScrollCtrlReport->Flag == 1) {
-					DevContext->sc.scrollInertiaActive = 1;
-				}
-				else {
-					DevContext->sc.scrollInertiaActive = 0;
-				}
-
-				break;
-
 			case REPORTID_SETTINGS:
 				pSettingsReport = (ElanSettingsReport *)transferPacket->reportBuffer;
 				ProcessSetting(DevContext, &DevContext->sc, pSettingsReport->SettingsRegister, pSettingsReport->SettingsValue);
@@ -556,6 +542,25 @@ OUT BOOLEAN* CompleteRequest
 				break;
 			}
 
+			case REPORTID_WHEELRES:
+			{
+
+				ElanWheelResolutionReport* pReport = NULL;
+
+				if (transferPacket->reportBufferLen == sizeof(ElanWheelResolutionReport))
+				{
+					pReport = (ElanWheelResolutionReport*)transferPacket->reportBuffer;
+
+					pReport->Multipliers = DevContext->WheelMultipliers;
+				}
+				else
+				{
+					status = STATUS_INVALID_PARAMETER;
+				}
+
+				break;
+			}
+
 			default:
 
 				ElanPrint(DEBUG_LEVEL_ERROR, DBG_IOCTL,
@@ -574,6 +579,87 @@ OUT BOOLEAN* CompleteRequest
 	return status;
 }
 
+NTSTATUS
+ElanSetFeature(
+IN PDEVICE_CONTEXT DevContext,
+IN WDFREQUEST Request
+)
+{
+	NTSTATUS status = STATUS_SUCCESS;
+	WDF_REQUEST_PARAMETERS params;
+	PHID_XFER_PACKET transferPacket = NULL;
+	ElanWheelResolutionReport *pWheelResReport = NULL;
+
+	ElanPrint(DEBUG_LEVEL_VERBOSE, DBG_IOCTL,
+		"ElanSetFeature Entry\n");
+
+	WDF_REQUEST_PARAMETERS_INIT(&params);
+	WdfRequestGetParameters(Request, &params);
+
+	if (params.Parameters.DeviceIoControl.InputBufferLength < sizeof(HID_XFER_PACKET))
+	{
+		ElanPrint(DEBUG_LEVEL_ERROR, DBG_IOCTL,
+			"ElanSetFeature Xfer packet too small\n");
+
+		status = STATUS_BUFFER_TOO_SMALL;
+	}
+	else
+	{
+
+		transferPacket = (PHID_XFER_PACKET)WdfRequestWdmGetIrp(Request)->UserBuffer;
+
+		if (transferPacket == NULL)
+		{
+			ElanPrint(DEBUG_LEVEL_ERROR, DBG_IOCTL,
+				"ElanSetFeature No xfer packet\n");
+
+			status = STATUS_INVALID_DEVICE_REQUEST;
+		}
+		else
+		{
+			//
+			// switch on the report id
+			//
+
+			switch (transferPacket->reportId)
+			{
+			case REPORTID_WHEELRES:
+
+				if (transferPacket->reportBufferLen < sizeof(ElanWheelResolutionReport))
+				{
+					status = STATUS_INVALID_PARAMETER;
+					break;
+				}
+
+				pWheelResReport = (ElanWheelResolutionReport *)transferPacket->reportBuffer;
+
+				DevContext->WheelMultipliers = pWheelResReport->Multipliers;
+				DevContext->sc.wheelresy = (pWheelResReport->Multipliers & WHEELRES_VERTICAL_MASK) ? WHEEL_RESOLUTION : 1;
+				DevContext->sc.wheelresx = (pWheelResReport->Multipliers & WHEELRES_HORIZONTAL_MASK) ? WHEEL_RESOLUTION : 1;
+
+				ElanPrint(DEBUG_LEVEL_INFO, DBG_IOCTL,
+					"ElanSetFeature WheelMultipliers = 0x%x\n", DevContext->WheelMultipliers);
+
+				break;
+
+			default:
+
+				ElanPrint(DEBUG_LEVEL_ERROR, DBG_IOCTL,
+					"ElanSetFeature Unhandled report type %d\n", transferPacket->reportId);
+
+				status = STATUS_INVALID_PARAMETER;
+
+				break;
+			}
+		}
+	}
+
+	ElanPrint(DEBUG_LEVEL_VERBOSE, DBG_IOCTL,
+		"ElanSetFeature Exit = 0x%x\n", status);
+
+	return status;
+}
+
 PCHAR
 DbgHidInternalIoctlString(
 IN ULONG IoControlCode
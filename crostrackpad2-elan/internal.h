@@ -27,6 +27,17 @@
 
 #include "elantp.h"
 #include "gesturerec.h"
+#include "hidcommon.h"
+
+//
+// Output streams whose last report is remembered so repeats can be dropped
+//
+
+enum elan_output {
+	ELAN_OUTPUT_MOUSE,
+	ELAN_OUTPUT_KEYBOARD,
+	ELAN_OUTPUT_MAX
+};
 
 //
 // Forward Declarations
@@ -93,15 +104,43 @@ struct _DEVICE_CONTEXT
 
 	BYTE DeviceMode;
 
+	BYTE WheelMultipliers;
+
 	ULONGLONG LastInterruptTime;
 
 	csgesture_softc sc;
 
-	uint16_t max_y;
-
-	uint8_t hw_res_x, hw_res_y;
+	uint16_t max_x, max_y;
 
 	uint8_t lastreport[ETP_MAX_REPORT_LEN];
+
+	//
+	// Frame validation counters
+	//
+
+	ULONG FramesAccepted;
+
+	ULONG FramesDropped[ETP_DROP_MAX];
+
+	//
+	// Gesture engine cost
+	//
+
+	ULONG GestureFrames;
+
+	ULONG64 GestureCycles;
+
+	//
+	// Last report delivered on each output stream
+	//
+
+	_ELAN_RELATIVE_MOUSE_REPORT LastMouseReport;
+
+	_ELAN_KEYBOARD_REPORT LastKeyboardReport;
+
+	ULONG ReportsSent[ELAN_OUTPUT_MAX];
+
+	ULONG ReportsSuppressed[ELAN_OUTPUT_MAX];
 };
 
 struct _REQUEST_CONTEXT
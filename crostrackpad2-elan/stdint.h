@@ -4,6 +4,8 @@ typedef signed int        int32_t;
 typedef unsigned char     uint8_t;
 typedef unsigned short    uint16_t;
 typedef unsigned int      uint32_t;
+typedef signed long long  int64_t;
+typedef unsigned long long uint64_t;
 
 #ifndef ABS32
 #define ABS32